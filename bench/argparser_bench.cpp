@@ -0,0 +1,311 @@
+// argparser_bench.cpp
+#include "lib/ArgParser.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> allocation_count{0};
+
+}
+
+// Every allocation in the process goes through here so cases can report allocs/op.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+using ArgumentParser::ArgHandle;
+using ArgumentParser::ArgParser;
+using ArgumentParser::ArgSpec;
+
+struct Measurement {
+    std::string name;
+    uint64_t param = 0;
+    uint64_t iterations = 0;
+    double ns_per_op = 0;
+    double allocs_per_op = 0;
+};
+
+struct Options {
+    bool json = false;
+    std::string json_path;
+    uint64_t max_tokens = 1000000;
+    uint64_t max_options = 10000;
+    double min_time_ms = 50;
+    std::string filter;
+};
+
+bool Selected(const Options& options, const std::string& name) {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// Runs body until min_time_ms has passed (at least once) and appends per-call figures,
+// unless the case is filtered out.
+void Measure(std::vector<Measurement>& out, const std::string& name, uint64_t param, const Options& options, const std::function<void()>& body) {
+    if (!Selected(options, name)) {
+        return;
+    }
+    using Clock = std::chrono::steady_clock;
+    Measurement result{name, param};
+    uint64_t iterations = 1;
+    while (true) {
+        uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            body();
+        }
+        double elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        uint64_t allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+        if (elapsed_ns >= options.min_time_ms * 1e6 || iterations >= (1ULL << 30)) {
+            result.iterations = iterations;
+            result.ns_per_op = elapsed_ns / static_cast<double>(iterations);
+            result.allocs_per_op = static_cast<double>(allocations) / static_cast<double>(iterations);
+            out.push_back(result);
+            return;
+        }
+        iterations *= elapsed_ns < options.min_time_ms * 1e5 ? 10 : 2;
+    }
+}
+
+// Token storage for one synthetic command line; views point into the strings.
+struct CommandLine {
+    std::vector<std::string> storage;
+    std::vector<std::string_view> tokens;
+
+    void Finish() {
+        tokens.assign(storage.begin(), storage.end());
+    }
+};
+
+CommandLine MakeCommandLine(const std::string& shape, uint64_t count) {
+    CommandLine line;
+    line.storage.reserve(count + 1);
+    line.storage.push_back("app");
+    for (uint64_t i = 1; i < count; ++i) {
+        if (shape == "long") {
+            line.storage.push_back("--value=" + std::to_string(i));
+        } else if (shape == "short_cluster") {
+            line.storage.push_back("-abc");
+        } else if (shape == "eq_form") {
+            line.storage.push_back("-n=" + std::to_string(i));
+        } else if (shape == "positional") {
+            line.storage.push_back("/data/input/file_" + std::to_string(i) + ".txt");
+        } else {
+            line.storage.push_back(std::to_string(i));
+        }
+    }
+    line.Finish();
+    return line;
+}
+
+void AddShapeArguments(ArgParser& parser) {
+    parser.AddIntArgument("value").MultiValue();
+    parser.AddFlag('a', "alpha");
+    parser.AddFlag('b', "beta");
+    parser.AddFlag('c', "gamma");
+    parser.AddIntArgument('n', "number").MultiValue();
+}
+
+void BenchRegistration(const Options& options, std::vector<Measurement>& out) {
+    std::vector<std::string> names;
+    for (uint64_t count = 10; count <= options.max_options; count *= 10) {
+        names.clear();
+        for (uint64_t i = 0; i < count; ++i) {
+            names.push_back("option" + std::to_string(i));
+        }
+        Measure(out, "registration", count, options, [&] {
+            ArgParser parser("bench");
+            for (const std::string& name : names) {
+                parser.AddIntArgument(name, "generated option").Default(1);
+            }
+            parser.Freeze();
+        });
+        std::vector<ArgSpec> specs;
+        for (const std::string& name : names) {
+            specs.push_back({.type = ArgSpec::INT, .name = name, .help = "generated option", .default_value = "1", .has_default = true});
+        }
+        Measure(out, "registration_bulk", count, options, [&] {
+            ArgParser parser("bench");
+            parser.AddArguments(specs);
+            parser.Freeze();
+        });
+    }
+}
+
+void BenchParse(const Options& options, std::vector<Measurement>& out) {
+    for (const char* shape : {"long", "short_cluster", "eq_form", "positional", "multivalue_int"}) {
+        if (!Selected(options, std::string("parse/") + shape)) {
+            continue;
+        }
+        for (uint64_t count = 10; count <= options.max_tokens; count *= 10) {
+            CommandLine line = MakeCommandLine(shape, count);
+            ArgParser parser("bench");
+            AddShapeArguments(parser);
+            if (std::string(shape) == "positional") {
+                parser.AddStringArgument("Inputs").MultiValue().Positional();
+            } else {
+                parser.AddIntArgument("Numbers").MultiValue().Positional();
+            }
+            parser.Freeze();
+            bool parsed = true;
+            Measure(out, std::string("parse/") + shape, count, options, [&] {
+                parsed = parser.Parse(line.tokens) && parsed;
+            });
+            if (!parsed) {
+                std::cerr << "parse/" << shape << " failed" << std::endl;
+            }
+        }
+    }
+}
+
+void BenchReset(const Options& options, std::vector<Measurement>& out) {
+    for (uint64_t count = 10; count <= std::min<uint64_t>(options.max_options, 1000); count *= 10) {
+        ArgParser parser("bench");
+        std::vector<int> stored(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            parser.AddIntArgument("option" + std::to_string(i)).StoreValue(stored[i]);
+        }
+        parser.Freeze();
+        CommandLine touch_two;
+        touch_two.storage = {"app", "--option0=1", "--option" + std::to_string(count - 1) + "=2"};
+        touch_two.Finish();
+        Measure(out, "reset/two_touched", count, options, [&] {
+            parser.Parse(touch_two.tokens);
+        });
+    }
+}
+
+void BenchGetters(const Options& options, std::vector<Measurement>& out) {
+    ArgParser parser("bench");
+    for (int i = 0; i < 100; ++i) {
+        parser.AddIntArgument("option" + std::to_string(i));
+    }
+    ArgHandle<int> handle = parser.AddIntArgument("target").Handle<int>();
+    ArgHandle<std::string> text = parser.AddStringArgument("text").Handle<std::string>();
+    parser.Freeze();
+    CommandLine line;
+    line.storage = {"app", "--target=42", "--text=hello"};
+    line.Finish();
+    parser.Parse(line.tokens);
+
+    const std::string target = "target";
+    volatile int sink = 0;
+    Measure(out, "get/int_by_name", 1, options, [&] {
+        sink = parser.GetIntValue(target);
+    });
+    Measure(out, "get/int_by_handle", 1, options, [&] {
+        sink = parser.Get(handle);
+    });
+    const std::string text_name = "text";
+    Measure(out, "get/string_by_name", 1, options, [&] {
+        sink = static_cast<int>(parser.GetStringValue(text_name).size());
+    });
+    Measure(out, "get/string_by_handle", 1, options, [&] {
+        sink = static_cast<int>(parser.Get(text).size());
+    });
+}
+
+void BenchHelp(const Options& options, std::vector<Measurement>& out) {
+    for (uint64_t count = 10; count <= std::min<uint64_t>(options.max_options, 1000); count *= 10) {
+        ArgParser parser("bench");
+        parser.AddHelp('h', "help", "Benchmark program");
+        for (uint64_t i = 0; i < count; ++i) {
+            parser.AddIntArgument("option" + std::to_string(i), "generated option").MultiValue(1).Default(3);
+        }
+        Measure(out, "help", count, options, [&] {
+            std::string help = parser.HelpDescription();
+        });
+    }
+}
+
+void WriteJson(std::ostream& os, const std::vector<Measurement>& measurements) {
+    os << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < measurements.size(); ++i) {
+        const Measurement& m = measurements[i];
+        os << "    {\"name\": \"" << m.name << "\", \"param\": " << m.param << ", \"iterations\": " << m.iterations
+           << ", \"ns_per_op\": " << m.ns_per_op << ", \"allocs_per_op\": " << m.allocs_per_op << "}"
+           << (i + 1 < measurements.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+}
+
+void WriteTable(std::ostream& os, const std::vector<Measurement>& measurements) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-28s %10s %12s %16s %14s\n", "benchmark", "param", "iterations", "ns/op", "allocs/op");
+    os << line;
+    for (const Measurement& m : measurements) {
+        std::snprintf(line, sizeof(line), "%-28s %10llu %12llu %16.1f %14.2f\n", m.name.c_str(),
+                      static_cast<unsigned long long>(m.param), static_cast<unsigned long long>(m.iterations),
+                      m.ns_per_op, m.allocs_per_op);
+        os << line;
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    ArgParser parser("argparser_bench");
+    parser.AddHelp('h', "help", "Measures ArgParser registration, parsing, reset, getters and help rendering");
+    parser.AddFlag("json", "print results as JSON").StoreValue(options.json);
+    parser.AddStringArgument("json-out", "write JSON results to this file").StoreValue(options.json_path);
+    parser.AddUInt64Argument("max-tokens", "largest argv size for parse benchmarks").Default(options.max_tokens).StoreValue(options.max_tokens);
+    parser.AddUInt64Argument("max-options", "largest schema size for registration").Default(options.max_options).StoreValue(options.max_options);
+    parser.AddDoubleArgument("min-time-ms", "minimum measuring time per case").Default(options.min_time_ms).StoreValue(options.min_time_ms);
+    parser.AddStringArgument('f', "filter", "run only benchmarks whose name contains this, e.g. parse/long").StoreValue(options.filter);
+
+    if (!parser.Parse(argc, argv)) {
+        std::cout << "Wrong argument" << std::endl;
+        std::cout << parser.HelpDescription() << std::endl;
+        return 1;
+    }
+    if (parser.Help()) {
+        std::cout << parser.HelpDescription() << std::endl;
+        return 0;
+    }
+
+    std::vector<Measurement> measurements;
+    // Each case is matched against the filter by its own name, e.g. parse/long.
+    for (auto run : {BenchRegistration, BenchParse, BenchReset, BenchGetters, BenchHelp}) {
+        run(options, measurements);
+    }
+
+    if (options.json) {
+        WriteJson(std::cout, measurements);
+    } else {
+        WriteTable(std::cout, measurements);
+    }
+    if (!options.json_path.empty()) {
+        std::ofstream file(options.json_path);
+        WriteJson(file, measurements);
+    }
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "Reduce.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Reduce {
+
+namespace {
+
+constexpr size_t kLanes = 8;
+constexpr size_t kParallelGrain = size_t(1) << 16;
+
+// Adds x to sum in two's complement and returns the crossing of the int64 range:
+// +1 past the top, -1 past the bottom, 0 otherwise. Branch-free for the vectorizer.
+inline int64_t AddWrapping(uint64_t& sum, uint64_t x) {
+    uint64_t result = sum + x;
+    int64_t crossed = static_cast<int64_t>((result ^ sum) & (result ^ x)) >> 63;
+    sum = result;
+    return crossed & (1 | (static_cast<int64_t>(x) >> 63));
+}
+
+// Multiplies the exact product (product, overflow, top) by the factor (x, x_overflow,
+// x_top) and keeps the wrapped value. An overflowed operand can only come back into
+// range if it is exactly 2^63 (top) and the other one is -1.
+inline void MultiplyChecked(uint64_t& product, bool& overflow, bool& top, uint64_t x, bool x_overflow, bool x_top) {
+    int64_t a = static_cast<int64_t>(product);
+    int64_t b = static_cast<int64_t>(x);
+    int64_t result;
+    bool wrapped = __builtin_mul_overflow(a, b, &result);
+    if (!overflow && !x_overflow) {
+        // 2^63 is the only overflowed product that wraps to INT64_MIN from factors of one sign
+        top = wrapped && result == INT64_MIN && (a < 0) == (b < 0);
+        overflow = wrapped;
+    } else if (overflow && x_overflow) {
+        top = false;
+    } else {
+        bool large_top = overflow ? top : x_top;
+        int64_t other = overflow ? b : a;
+        overflow = !(large_top && other == -1);
+        top = large_top && other == 1;
+    }
+    product = static_cast<uint64_t>(result);
+}
+
+}
+
+Accumulator Accumulator::Identity(Operation operation) {
+    Accumulator accumulator;
+    accumulator.operation = operation;
+    accumulator.value = operation == Operation::SUM ? 0 : 1;
+    return accumulator;
+}
+
+void Accumulator::Add(int64_t x) {
+    if (operation == Operation::SUM) {
+        wraps += AddWrapping(value, static_cast<uint64_t>(x));
+    } else if (operation == Operation::WRAPPING_PRODUCT) {
+        value *= static_cast<uint64_t>(x);
+    } else {
+        MultiplyChecked(value, overflow, top, static_cast<uint64_t>(x), false, false);
+        zero |= x == 0;
+    }
+}
+
+void Accumulator::Merge(const Accumulator& other) {
+    if (operation == Operation::SUM) {
+        wraps += other.wraps + AddWrapping(value, other.value);
+    } else if (operation == Operation::WRAPPING_PRODUCT) {
+        value *= other.value;
+    } else {
+        MultiplyChecked(value, overflow, top, other.value, other.overflow, other.top);
+        zero |= other.zero;
+    }
+}
+
+bool Accumulator::Fits(unsigned bits) const {
+    bool fits64 = operation == Operation::SUM ? wraps == 0 : zero || !overflow;
+    if (operation == Operation::WRAPPING_PRODUCT) {
+        fits64 = true;
+    }
+    if (!fits64 || bits >= 64) {
+        return fits64;
+    }
+    int64_t signed_value = static_cast<int64_t>(value);
+    int64_t limit = int64_t(1) << (bits - 1);
+    return signed_value >= -limit && signed_value < limit;
+}
+
+int64_t Accumulator::Wrapped(unsigned bits) const {
+    if (bits >= 64) {
+        return static_cast<int64_t>(value);
+    }
+    uint64_t shift = 64 - bits;
+    return static_cast<int64_t>(value << shift) >> shift;
+}
+
+Accumulator ReduceSpan(std::span<const int64_t> values, Operation operation) {
+    Accumulator result = Accumulator::Identity(operation);
+    size_t blocked = values.size() - values.size() % kLanes;
+    if (operation == Operation::SUM) {
+        uint64_t sums[kLanes] = {};
+        int64_t wraps[kLanes] = {};
+        for (size_t i = 0; i < blocked; i += kLanes) {
+            for (size_t lane = 0; lane < kLanes; ++lane) {
+                wraps[lane] += AddWrapping(sums[lane], static_cast<uint64_t>(values[i + lane]));
+            }
+        }
+        for (size_t lane = 0; lane < kLanes; ++lane) {
+            result.wraps += wraps[lane] + AddWrapping(result.value, sums[lane]);
+        }
+    } else if (operation == Operation::WRAPPING_PRODUCT) {
+        uint64_t products[kLanes];
+        std::fill(products, products + kLanes, 1);
+        for (size_t i = 0; i < blocked; i += kLanes) {
+            for (size_t lane = 0; lane < kLanes; ++lane) {
+                products[lane] *= static_cast<uint64_t>(values[i + lane]);
+            }
+        }
+        for (size_t lane = 0; lane < kLanes; ++lane) {
+            result.value *= products[lane];
+        }
+    } else {
+        uint64_t products[kLanes];
+        std::fill(products, products + kLanes, 1);
+        bool overflow[kLanes] = {};
+        bool top[kLanes] = {};
+        bool zero[kLanes] = {};
+        for (size_t i = 0; i < blocked; i += kLanes) {
+            for (size_t lane = 0; lane < kLanes; ++lane) {
+                MultiplyChecked(products[lane], overflow[lane], top[lane], static_cast<uint64_t>(values[i + lane]), false, false);
+                zero[lane] |= values[i + lane] == 0;
+            }
+        }
+        for (size_t lane = 0; lane < kLanes; ++lane) {
+            MultiplyChecked(result.value, result.overflow, result.top, products[lane], overflow[lane], top[lane]);
+            result.zero |= zero[lane];
+        }
+    }
+    for (size_t i = blocked; i < values.size(); ++i) {
+        result.Add(values[i]);
+    }
+    return result;
+}
+
+Accumulator ReduceParallel(std::span<const int64_t> values, Operation operation, ArgumentParser::ThreadPool& pool) {
+    if (values.size() < kParallelThreshold || pool.Size() == 1) {
+        return ReduceSpan(values, operation);
+    }
+    std::vector<Accumulator> partials((values.size() + kParallelGrain - 1) / kParallelGrain);
+    pool.ParallelFor(values.size(), kParallelGrain, [&](size_t begin, size_t end) {
+        partials[begin / kParallelGrain] = ReduceSpan(values.subspan(begin, end - begin), operation);
+    });
+    Accumulator result = Accumulator::Identity(operation);
+    for (const Accumulator& partial : partials) {
+        result.Merge(partial);
+    }
+    return result;
+}
+
+void StreamReducer::Select(Operation operation) {
+    selected_ = true;
+    operation_ = operation;
+    if (operation != Operation::SUM) {
+        // The checked product so far is also the wrapped one.
+        product_.operation = operation;
+    }
+}
+
+void StreamReducer::Flush() {
+    std::span<const int64_t> block(block_, size_);
+    if (!selected_ || operation_ == Operation::SUM) {
+        sum_.Merge(ReduceSpan(block, Operation::SUM));
+    }
+    if (!selected_ || operation_ != Operation::SUM) {
+        product_.Merge(ReduceSpan(block, product_.operation));
+    }
+    size_ = 0;
+}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "lib/ThreadPool.h"
+
+namespace Reduce {
+
+// WRAPPING_PRODUCT keeps only the product modulo 2^64, for results that are not checked.
+enum class Operation { SUM, PRODUCT, WRAPPING_PRODUCT };
+
+// Running sum or product of int64 values. value wraps modulo 2^64; the other fields keep
+// enough to tell whether the exact result fits into a narrower signed integer.
+struct Accumulator {
+    Operation operation = Operation::SUM;
+    uint64_t value = 0;
+    // Sum: how many times the exact sum has crossed the int64 range, signed.
+    int64_t wraps = 0;
+    // Product: the exact product left the int64 range. Its magnitude never shrinks again
+    // unless a zero factor shows up, so this sticks, except that exactly 2^63 (top)
+    // times -1 is INT64_MIN.
+    bool overflow = false;
+    bool top = false;
+    bool zero = false;
+
+    static Accumulator Identity(Operation operation);
+
+    void Add(int64_t x);
+    void Merge(const Accumulator& other);
+
+    // Whether the exact result fits into a signed integer of bits. A WRAPPING_PRODUCT has
+    // no overflow record, so only its wrapped value is checked.
+    bool Fits(unsigned bits) const;
+    // Result modulo 2^bits, as a signed integer of that width.
+    int64_t Wrapped(unsigned bits) const;
+};
+
+// Below this many values ReduceParallel runs inline, so no pool is worth starting.
+constexpr size_t kParallelThreshold = size_t(1) << 20;
+
+// Multi-lane kernel. The sum and wrapping product lanes are branch-free and vectorize,
+// the product lanes only where the target has wide 64-bit multiplies (AVX2 and up);
+// the checked product lanes just break up the dependency chain, since the overflow
+// checking multiply stays scalar.
+Accumulator ReduceSpan(std::span<const int64_t> values, Operation operation);
+
+// Splits values into chunks reduced on the pool and merged in order.
+Accumulator ReduceParallel(std::span<const int64_t> values, Operation operation, ArgumentParser::ThreadPool& pool);
+
+// Reduces values as they arrive in fixed-size blocks. Blocks completed before Select()
+// are reduced both ways, since the operation may be named after the first values.
+class StreamReducer {
+public:
+    void Select(Operation operation);
+
+    void Push(int64_t x) {
+        block_[size_++] = x;
+        if (size_ == kBlockSize) {
+            Flush();
+        }
+    }
+
+    void Flush();
+
+    const Accumulator& Result(Operation operation) const {
+        return operation == Operation::SUM ? sum_ : product_;
+    }
+    bool Selected() const {
+        return selected_;
+    }
+
+private:
+    static constexpr size_t kBlockSize = 4096;
+
+    int64_t block_[kBlockSize];
+    size_t size_ = 0;
+    bool selected_ = false;
+    Operation operation_ = Operation::SUM;
+    Accumulator sum_ = Accumulator::Identity(Operation::SUM);
+    Accumulator product_ = Accumulator::Identity(Operation::PRODUCT);
+};
+
+}
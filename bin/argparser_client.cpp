@@ -0,0 +1,55 @@
+// argparser_client.cpp
+// Thin stand-in for a tool whose parser runs in a CommandServer: forwards its own argv to
+// the socket named by ARGPARSER_SOCKET and prints the parsed values as name=value lines,
+// those of a subcommand as subcommand.name=value.
+#include "lib/CommandServer.h"
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char** argv) {
+    const char* path = std::getenv("ARGPARSER_SOCKET");
+    if (!path) {
+        std::cerr << "ARGPARSER_SOCKET is not set" << std::endl;
+        return 2;
+    }
+
+    std::vector<std::string_view> args(argv, argv + argc);
+    ArgumentParser::CommandReply reply;
+    if (!ArgumentParser::SendCommand(path, args, reply)) {
+        std::cerr << "No reply from " << path << std::endl;
+        return 2;
+    }
+
+    if (reply.error != ArgumentParser::ParseError::NONE) {
+        std::cerr << "Wrong argument";
+        if (reply.error_index != ArgumentParser::ParseResult::npos) {
+            std::cerr << " at " << reply.error_index;
+        }
+        if (!reply.error_argument.empty()) {
+            std::cerr << " (" << reply.error_argument << ")";
+        }
+        if (!reply.suggestion.empty()) {
+            std::cerr << ", did you mean --" << reply.suggestion << "?";
+        }
+        std::cerr << std::endl;
+        return 1;
+    }
+
+    if (reply.help) {
+        std::cout << reply.help_text << std::endl;
+        return 0;
+    }
+
+    // Subcommand values are printed as subcommand.name=value.
+    std::string prefix;
+    for (const ArgumentParser::CommandReply* level = &reply; level; level = level->subcommand_reply.get()) {
+        for (const auto& [name, values] : level->values) {
+            for (const std::string& value : values) {
+                std::cout << prefix << name << "=" << value << "\n";
+            }
+        }
+        prefix += level->subcommand + ".";
+    }
+
+    return 0;
+}
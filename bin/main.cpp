@@ -1,32 +1,60 @@
 // main.cpp
-#include <functional>
 #include "lib/ArgParser.h"
-#include <sstream>
-#include <fstream>
+#include "lib/ThreadPool.h"
+#include "Reduce.h"
 #include <iostream>
-#include <iterator>
-#include <numeric>
 
 struct Options {
     bool sum = false;
     bool mult = false;
+    bool wide = false;
+    bool checked = false;
+    bool stream = false;
+    int threads = 0;
 };
 
-std::vector<std::string> SplitString(const std::string& str) {
-    std::istringstream iss(str);
-
-    return {std::istream_iterator<std::string>(iss), std::istream_iterator<std::string>()};
+// Unchecked products only need the wrapped value, which vectorizes.
+Reduce::Operation Operation(bool sum, bool checked) {
+    if (sum) {
+        return Reduce::Operation::SUM;
+    }
+    return checked ? Reduce::Operation::PRODUCT : Reduce::Operation::WRAPPING_PRODUCT;
 }
 
 int main(int argc, char** argv) {
     Options opt;
-    std::vector<int> values;
+    std::vector<int64_t> values;
+    Reduce::StreamReducer stream;
 
     ArgumentParser::ArgParser parser("Program");
-    parser.AddIntArgument("N").MultiValue(1).Positional().StoreValues(values);
-    parser.AddFlag("sum", "add args").StoreValue(opt.sum);
-    parser.AddFlag("mult", "multiply args").StoreValue(opt.mult);
-    parser.AddHelp('h', "help", "Program accumulate arguments");
+    ArgumentParser::ArgHandle<bool> sum_flag;
+    ArgumentParser::ArgHandle<bool> mult_flag;
+    ArgumentParser::ArgHandle<bool> stream_flag;
+    // Flags are read from the live result, so wherever they came from (argv, @file,
+    // abbreviation) they count from the point they were parsed. Values before --stream
+    // are kept and reduced after parsing, the rest as they arrive, and only the selected
+    // operation once it is known.
+    parser.AddInt64Argument("N").MultiValue(1).Positional().OnValue([&](int64_t value) {
+        const ArgumentParser::ParseResult& live = parser.Result();
+        if (!live.Get(stream_flag)) {
+            values.push_back(value);
+            return;
+        }
+        if (!stream.Selected() && (live.Get(sum_flag) || live.Get(mult_flag))) {
+            // --checked may still follow, so the product keeps its overflow record.
+            stream.Select(live.Get(sum_flag) ? Reduce::Operation::SUM : Reduce::Operation::PRODUCT);
+        }
+        stream.Push(value);
+    });
+    sum_flag = parser.AddFlag("sum", "add args").StoreValue(opt.sum).Handle<bool>();
+    mult_flag = parser.AddFlag("mult", "multiply args").StoreValue(opt.mult).Handle<bool>();
+    parser.AddFlag("wide", "64-bit result instead of 32-bit").StoreValue(opt.wide);
+    parser.AddFlag("checked", "fail on overflow instead of wrapping").StoreValue(opt.checked);
+    stream_flag = parser.AddFlag("stream", "reduce values while they are parsed, in constant memory").StoreValue(opt.stream).Handle<bool>();
+    parser.AddIntArgument("threads", "reduction threads, 0 for one per core").Default(0).StoreValue(opt.threads);
+    parser.AddHelp('h', "help", "Program accumulate arguments, also read from @file");
+    parser.ResponseFiles();
+    parser.Abbreviations();
 
     if (!parser.Parse(argc, argv)) {
         std::cout << "Wrong argument" << std::endl;
@@ -39,15 +67,34 @@ int main(int argc, char** argv) {
         return 0;
     }
 
-    if (opt.sum) {
-        std::cout << "Result: " << std::accumulate(values.begin(), values.end(), 0) << std::endl;
-    } else if (opt.mult) {
-        std::cout << "Result: " << std::accumulate(values.begin(), values.end(), 1, std::multiplies<int>()) << std::endl;
-    } else {
-        std::cout << "No one options had chosen" << std::endl;
+    if (opt.sum == opt.mult) {
+        std::cout << "Choose one of --sum and --mult" << std::endl;
         std::cout << parser.HelpDescription();
         return 1;
     }
 
+    Reduce::Operation operation = Operation(opt.sum, opt.checked);
+    Reduce::Accumulator result;
+    if (opt.stream) {
+        stream.Select(operation);
+        for (int64_t value : values) {
+            stream.Push(value);
+        }
+        stream.Flush();
+        result = stream.Result(operation);
+    } else if (values.size() < Reduce::kParallelThreshold) {
+        result = Reduce::ReduceSpan(values, operation);
+    } else {
+        ArgumentParser::ThreadPool pool(static_cast<size_t>(std::max(opt.threads, 0)));
+        result = Reduce::ReduceParallel(values, operation, pool);
+    }
+
+    unsigned bits = opt.wide ? 64 : 32;
+    if (opt.checked && !result.Fits(bits)) {
+        std::cout << "Overflow" << std::endl;
+        return 1;
+    }
+    std::cout << "Result: " << result.Wrapped(bits) << std::endl;
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,54 +1,77 @@
 
 #include "ArgParser.h"
-#include <iostream>
+#include "ThreadPool.h"
 #include <sstream>
 #include <iterator>
+#include <algorithm>
+#include <atomic>
 
 
 namespace ArgumentParser {
 
 ArgParser::ArgParser(const std::string& program_name) : program_name_(program_name) {}
 
-ArgParser& ArgParser::AddStringArgument(const std::string& name, const std::string& help) {
-    return AddStringArgument('\0', name, help);
-}
+ArgParser::ArgParser(const std::string& program_name, std::pmr::memory_resource* resource)
+    : program_name_(program_name), result_(resource) {}
 
-ArgParser& ArgParser::AddStringArgument(char short_name, const std::string& name, const std::string& help) {
-    Argument arg;
-    arg.type = Argument::STRING;
-    arg.name = name;
+ArgParser& ArgParser::AddArgument(Argument::Type type, char short_name, const std::string& name, const std::string& help) {
+    uint32_t index = static_cast<uint32_t>(arguments_.size());
+    Argument& arg = arguments_.emplace_back();
+    arg.type = type;
+    arg.index = index;
     arg.short_name = short_name;
-    arg.help = help;
-    arguments_.push_back(arg);
-    auto it = std::prev(arguments_.end());
-    name_to_arg_[name] = &(*it);
+    arg.is_help = name == "help";
+    ArgumentDetails& details = details_.emplace_back();
+    details.name = name;
+    details.help = help;
+    long_names_.Insert(name, index);
     if (short_name) {
-        short_name_to_arg_[short_name] = &(*it);
+        short_name_to_arg_[short_name] = index;
     }
-    current_arg_ = &(*it);
+    current_arg_ = &arg;
+    frozen_ = false;
 
     return *this;
 }
 
+ArgParser& ArgParser::AddStringArgument(const std::string& name, const std::string& help) {
+    return AddStringArgument('\0', name, help);
+}
+
+ArgParser& ArgParser::AddStringArgument(char short_name, const std::string& name, const std::string& help) {
+    return AddArgument(Argument::STRING, short_name, name, help);
+}
+
 ArgParser& ArgParser::AddIntArgument(const std::string& name, const std::string& help) {
     return AddIntArgument('\0', name, help);
 }
 
 ArgParser& ArgParser::AddIntArgument(char short_name, const std::string& name, const std::string& help) {
-    Argument arg;
-    arg.type = Argument::INT;
-    arg.name = name;
-    arg.short_name = short_name;
-    arg.help = help;
-    arguments_.push_back(arg);
-    auto it = std::prev(arguments_.end());
-    name_to_arg_[name] = &(*it);
-    if (short_name) {
-        short_name_to_arg_[short_name] = &(*it);
-    }
-    current_arg_ = &(*it);
+    return AddArgument(Argument::INT, short_name, name, help);
+}
 
-    return *this;
+ArgParser& ArgParser::AddInt64Argument(const std::string& name, const std::string& help) {
+    return AddInt64Argument('\0', name, help);
+}
+
+ArgParser& ArgParser::AddInt64Argument(char short_name, const std::string& name, const std::string& help) {
+    return AddArgument(Argument::INT64, short_name, name, help);
+}
+
+ArgParser& ArgParser::AddUInt64Argument(const std::string& name, const std::string& help) {
+    return AddUInt64Argument('\0', name, help);
+}
+
+ArgParser& ArgParser::AddUInt64Argument(char short_name, const std::string& name, const std::string& help) {
+    return AddArgument(Argument::UINT64, short_name, name, help);
+}
+
+ArgParser& ArgParser::AddDoubleArgument(const std::string& name, const std::string& help) {
+    return AddDoubleArgument('\0', name, help);
+}
+
+ArgParser& ArgParser::AddDoubleArgument(char short_name, const std::string& name, const std::string& help) {
+    return AddArgument(Argument::DOUBLE, short_name, name, help);
 }
 
 ArgParser& ArgParser::AddFlag(const std::string& name, const std::string& help) {
@@ -56,64 +79,300 @@ ArgParser& ArgParser::AddFlag(const std::string& name, const std::string& help)
 }
 
 ArgParser& ArgParser::AddFlag(char short_name, const std::string& name, const std::string& help) {
-    Argument arg;
-    arg.type = Argument::FLAG;
-    arg.name = name;
-    arg.short_name = short_name;
-    arg.help = help;
-    arguments_.push_back(arg);
-    auto it = std::prev(arguments_.end());
-    name_to_arg_[name] = &(*it);
-    if (short_name) {
-        short_name_to_arg_[short_name] = &(*it);
+    return AddArgument(Argument::FLAG, short_name, name, help);
+}
+
+ArgParser& ArgParser::AddHelp(char short_name, const std::string& name, const std::string& description) {
+    help_description_ = description;
+    return AddArgument(Argument::FLAG, short_name, name, "Display this help and exit");
+}
+
+bool ArgParser::SetDefaultText(const Argument& arg, ArgumentDetails& details, std::string_view text) {
+    switch (arg.type) {
+        case Argument::STRING:
+            details.default_string_value.assign(text);
+            return true;
+        case Argument::INT:
+            return ConvertValue(text, details.ints.default_value) == ConvertResult::OK;
+        case Argument::INT64:
+            return ConvertValue(text, details.int64s.default_value) == ConvertResult::OK;
+        case Argument::UINT64:
+            return ConvertValue(text, details.uint64s.default_value) == ConvertResult::OK;
+        case Argument::DOUBLE:
+            return ConvertValue(text, details.doubles.default_value) == ConvertResult::OK;
+        case Argument::FLAG:
+            details.default_bool_value = text == "true";
+            return text == "true" || text == "false";
+        case Argument::CUSTOM:
+            break;
     }
-    current_arg_ = &(*it);
+    return false;
+}
 
+bool ArgParser::AddArguments(std::span<const ArgSpec> specs) {
+    size_t first = arguments_.size();
+    arguments_.reserve(first + specs.size());
+    details_.reserve(first + specs.size());
+    size_t name_bytes = 0;
+    for (const ArgSpec& spec : specs) {
+        name_bytes += spec.name.size();
+    }
+    // At most one node per name byte, added to the nodes already stored
+    long_names_.Reserve(name_bytes);
+    bool defaults_converted = true;
+    for (const ArgSpec& spec : specs) {
+        uint32_t index = static_cast<uint32_t>(arguments_.size());
+        Argument& arg = arguments_.emplace_back();
+        arg.type = static_cast<Argument::Type>(spec.type);
+        arg.index = index;
+        arg.short_name = spec.short_name;
+        arg.is_help = spec.name == "help";
+        arg.is_positional = spec.positional;
+        arg.is_multi_value = spec.multi_value;
+        arg.min_count = spec.multi_value ? spec.min_count : 0;
+        arg.required = spec.required;
+        ArgumentDetails& details = details_.emplace_back();
+        details.name.assign(spec.name);
+        details.help.assign(spec.help);
+        if (spec.has_default) {
+            arg.has_default = SetDefaultText(arg, details, spec.default_value);
+            defaults_converted = defaults_converted && arg.has_default;
+        }
+        // Indices only grow here, so the list stays sorted without a search.
+        if (arg.has_default || arg.required || arg.min_count > 0) {
+            arg.validated = true;
+            validation_args_.push_back(index);
+        }
+        if (arg.is_positional) {
+            positional_args_.push_back(index);
+        }
+        if (arg.short_name) {
+            short_name_to_arg_[arg.short_name] = index;
+        }
+        // A repeated name keeps its last registration, as with Add*Argument.
+        long_names_.Insert(details.name, index);
+    }
+    current_arg_ = nullptr;
+    frozen_ = false;
+    return defaults_converted;
+}
+
+ArgParser& ArgParser::AddSubcommand(const std::string& name, SubcommandFactory factory, const std::string& help) {
+    if (subcommand_index_.count(name)) {
+        return *this;
+    }
+    SubcommandEntry& entry = subcommands_.emplace_back();
+    entry.name = name;
+    entry.help = help;
+    entry.factory = std::move(factory);
+    subcommand_index_.emplace(entry.name, static_cast<uint32_t>(subcommands_.size() - 1));
+    current_arg_ = nullptr;
     return *this;
 }
 
-ArgParser& ArgParser::AddHelp(char short_name, const std::string& name, const std::string& description) {
-    help_description_ = description;
-    Argument arg;
-    arg.type = Argument::FLAG;
-    arg.name = name;
-    arg.short_name = short_name;
-    arg.help = "Display this help and exit";
-    arguments_.push_back(arg);
-    auto it = std::prev(arguments_.end());
-    name_to_arg_[name] = &(*it);
-    if (short_name) {
-        short_name_to_arg_[short_name] = &(*it);
+ArgParser& ArgParser::BuildSubcommand(SubcommandEntry& entry) const {
+    std::call_once(entry.built, [this, &entry] {
+        entry.parser = std::make_unique<ArgParser>(program_name_ + " " + entry.name);
+        if (entry.factory) {
+            entry.factory(*entry.parser);
+        }
+        if (abbreviations_) {
+            entry.parser->Abbreviations();
+        }
+        if (frozen_) {
+            entry.parser->Freeze();
+        }
+    });
+    return *entry.parser;
+}
+
+ArgParser* ArgParser::Subcommand(std::string_view name) {
+    auto it = subcommand_index_.find(name);
+    return it == subcommand_index_.end() ? nullptr : &BuildSubcommand(subcommands_[it->second]);
+}
+
+std::string_view ArgParser::SelectedSubcommand() const {
+    return result_.Subcommand();
+}
+
+ArgParser& ArgParser::Freeze() {
+    std::vector<std::string_view> names;
+    names.reserve(long_names_.Size());
+    long_table_args_.clear();
+    long_table_args_.reserve(long_names_.Size());
+    // A name registered twice only maps to its last argument.
+    for (const Argument& arg : arguments_) {
+        const std::string& name = details_[arg.index].name;
+        if (long_names_.Find(name) == arg.index) {
+            names.push_back(name);
+            long_table_args_.push_back(&arg);
+        }
+    }
+    long_table_.Build(names);
+    short_table_.fill(nullptr);
+    for (const auto& [short_name, index] : short_name_to_arg_) {
+        short_table_[static_cast<unsigned char>(short_name)] = &arguments_[index];
     }
-    current_arg_ = &(*it);
+    frozen_ = true;
+    return *this;
+}
+
+bool ArgParser::Frozen() const {
+    return frozen_;
+}
+
+ArgParser& ArgParser::ParallelConversion(size_t threads, size_t min_run) {
+    parallel_conversion_ = true;
+    conversion_threads_ = threads;
+    parallel_min_run_ = std::max<size_t>(min_run, 1);
+    return *this;
+}
+
+ThreadPool& ArgParser::Workers(size_t threads) const {
+    std::call_once(workers_->created, [this, threads] {
+        workers_->pool = std::make_shared<ThreadPool>(threads);
+    });
+    return *workers_->pool;
+}
 
+ArgParser& ArgParser::LazyConversion(bool enabled) {
+    lazy_ = enabled;
     return *this;
 }
 
+bool ArgParser::ValidateAll() {
+    return result_.ValidateAll();
+}
+
+ArgParser& ArgParser::ResponseFiles(bool enabled) {
+    response_files_ = enabled;
+    return *this;
+}
+
+ArgParser& ArgParser::Abbreviations(bool enabled) {
+    abbreviations_ = enabled;
+    return *this;
+}
+
+const ArgParser::Argument* ArgParser::FindLong(std::string_view name) const {
+    if (frozen_) {
+        size_t index = long_table_.Find(name);
+        return index == PerfectHash::npos ? nullptr : long_table_args_[index];
+    }
+    uint32_t index = long_names_.Find(name);
+    return index == OptionTrie::npos ? nullptr : &arguments_[index];
+}
+
+const ArgParser::Argument* ArgParser::MatchLong(std::string_view name, ParseError& error, std::string_view& suggestion) const {
+    const Argument* arg_ptr = FindLong(name);
+    if (arg_ptr) {
+        return arg_ptr;
+    }
+    bool ambiguous = false;
+    if (abbreviations_) {
+        uint32_t index = long_names_.FindPrefix(name, &ambiguous);
+        if (index != OptionTrie::npos) {
+            return &arguments_[index];
+        }
+    }
+    error = ambiguous ? ParseError::AMBIGUOUS_OPTION : ParseError::UNKNOWN_OPTION;
+    suggestion = {};
+    if (!ambiguous) {
+        // Up to a third of the name may be mistyped, but never more than 3 edits.
+        uint32_t nearest = long_names_.Nearest(name, std::clamp<size_t>(name.size() / 3, 1, 3));
+        if (nearest != OptionTrie::npos) {
+            suggestion = details_[nearest].name;
+        }
+    }
+    return nullptr;
+}
+
+const ArgParser::Argument* ArgParser::FindShort(char short_name) const {
+    if (frozen_) {
+        return short_table_[static_cast<unsigned char>(short_name)];
+    }
+    auto it = short_name_to_arg_.find(short_name);
+    return it == short_name_to_arg_.end() ? nullptr : &arguments_[it->second];
+}
+
+void ArgParser::TrackValidation(Argument& arg) {
+    if (arg.validated) {
+        return;
+    }
+    arg.validated = true;
+    validation_args_.insert(std::lower_bound(validation_args_.begin(), validation_args_.end(), arg.index), arg.index);
+}
+
 // Модификаторы
 ArgParser& ArgParser::Default(const std::string& value) {
-    if (current_arg_ && current_arg_->type == Argument::STRING) {
+    if (!current_arg_) {
+        return *this;
+    }
+    if (current_arg_->type == Argument::CUSTOM) {
+        alignas(kMaxValueAlign) std::byte scratch[kMaxValueSize];
+        DetailsOf(*current_arg_).default_invalid = !DetailsOf(*current_arg_).value_type->convert(value, scratch);
+    } else if (current_arg_->type != Argument::STRING) {
+        return *this;
+    }
+    current_arg_->has_default = true;
+    TrackValidation(*current_arg_);
+    DetailsOf(*current_arg_).default_string_value = value;
+    return *this;
+}
+
+ArgParser& ArgParser::Default(const char* value) {
+    return Default(std::string(value));
+}
+
+template <typename T>
+ArgParser& ArgParser::SetNumericDefault(T value) {
+    if (current_arg_ && current_arg_->type == kNumericType<T>) {
         current_arg_->has_default = true;
-        current_arg_->default_string_value = value;
+        TrackValidation(*current_arg_);
+        DetailsOf(*current_arg_).Numeric<T>().default_value = value;
     }
     return *this;
 }
 
 ArgParser& ArgParser::Default(int value) {
-    if (current_arg_ && current_arg_->type == Argument::INT) {
-        current_arg_->has_default = true;
-        current_arg_->default_int_value = value;
+    if (current_arg_) {
+        switch (current_arg_->type) {
+            case Argument::INT64:
+                return SetNumericDefault(static_cast<int64_t>(value));
+            case Argument::UINT64:
+                if (value >= 0) {
+                    return SetNumericDefault(static_cast<uint64_t>(value));
+                }
+                break;
+            case Argument::DOUBLE:
+                return SetNumericDefault(static_cast<double>(value));
+            default:
+                return SetNumericDefault(value);
+        }
     }
     return *this;
 }
 
+ArgParser& ArgParser::Default(int64_t value) {
+    return SetNumericDefault(value);
+}
+
+ArgParser& ArgParser::Default(uint64_t value) {
+    return SetNumericDefault(value);
+}
+
+ArgParser& ArgParser::Default(double value) {
+    return SetNumericDefault(value);
+}
+
 ArgParser& ArgParser::Default(bool value) {
     if (current_arg_ && current_arg_->type == Argument::FLAG) {
         current_arg_->has_default = true;
-        current_arg_->default_bool_value = value;
-        current_arg_->bool_value = value;
-        if (current_arg_->store_bool) {
-            *(current_arg_->store_bool) = value;
+        TrackValidation(*current_arg_);
+        ArgumentDetails& details = DetailsOf(*current_arg_);
+        details.default_bool_value = value;
+        if (details.store_bool) {
+            *(details.store_bool) = value;
         }
     }
     return *this;
@@ -122,7 +381,10 @@ ArgParser& ArgParser::Default(bool value) {
 ArgParser& ArgParser::MultiValue(size_t min_count) {
     if (current_arg_) {
         current_arg_->is_multi_value = true;
-        current_arg_->min_count = min_count;
+        current_arg_->min_count = static_cast<uint32_t>(std::min<size_t>(min_count, UINT32_MAX));
+        if (min_count > 0) {
+            TrackValidation(*current_arg_);
+        }
     }
     return *this;
 }
@@ -130,7 +392,7 @@ ArgParser& ArgParser::MultiValue(size_t min_count) {
 ArgParser& ArgParser::Positional() {
     if (current_arg_) {
         current_arg_->is_positional = true;
-        positional_args_.push_back(current_arg_);
+        positional_args_.push_back(current_arg_->index);
     }
     return *this;
 }
@@ -138,364 +400,809 @@ ArgParser& ArgParser::Positional() {
 ArgParser& ArgParser::Required() {
     if (current_arg_) {
         current_arg_->required = true;
+        TrackValidation(*current_arg_);
     }
     return *this;
 }
 
 ArgParser& ArgParser::StoreValue(std::string& value) {
     if (current_arg_ && current_arg_->type == Argument::STRING) {
-        current_arg_->store_string = &value;
-        value = current_arg_->has_default ? current_arg_->default_string_value : "";
+        ArgumentDetails& details = DetailsOf(*current_arg_);
+        details.store_string = &value;
+        current_arg_->has_store = true;
+        value = current_arg_->has_default ? details.default_string_value : "";
     }
     return *this;
 }
 
-ArgParser& ArgParser::StoreValue(int& value) {
-    if (current_arg_ && current_arg_->type == Argument::INT) {
-        current_arg_->store_int = &value;
-        value = current_arg_->has_default ? current_arg_->default_int_value : 0;
+template <typename T>
+ArgParser& ArgParser::SetNumericStore(T& value) {
+    if (current_arg_ && current_arg_->type == kNumericType<T>) {
+        NumericBinding<T>& numeric = DetailsOf(*current_arg_).Numeric<T>();
+        numeric.store = &value;
+        current_arg_->has_store = true;
+        value = current_arg_->has_default ? numeric.default_value : T();
     }
     return *this;
 }
 
+template <typename T>
+ArgParser& ArgParser::SetNumericStoreVector(std::vector<T>& values) {
+    if (current_arg_ && current_arg_->type == kNumericType<T>) {
+        DetailsOf(*current_arg_).Numeric<T>().store_vector = &values;
+        current_arg_->has_store = true;
+    }
+    return *this;
+}
+
+ArgParser& ArgParser::StoreValue(int& value) {
+    return SetNumericStore(value);
+}
+
+ArgParser& ArgParser::StoreValue(int64_t& value) {
+    return SetNumericStore(value);
+}
+
+ArgParser& ArgParser::StoreValue(uint64_t& value) {
+    return SetNumericStore(value);
+}
+
+ArgParser& ArgParser::StoreValue(double& value) {
+    return SetNumericStore(value);
+}
+
 ArgParser& ArgParser::StoreValue(bool& value) {
     if (current_arg_ && current_arg_->type == Argument::FLAG) {
-        current_arg_->store_bool = &value;
-        value = current_arg_->bool_value;
+        ArgumentDetails& details = DetailsOf(*current_arg_);
+        details.store_bool = &value;
+        current_arg_->has_store = true;
+        value = current_arg_->has_default ? details.default_bool_value : false;
     }
     return *this;
 }
 
 ArgParser& ArgParser::StoreValues(std::vector<std::string>& values) {
     if (current_arg_ && current_arg_->type == Argument::STRING) {
-        current_arg_->store_string_vector = &values;
+        DetailsOf(*current_arg_).store_string_vector = &values;
+        current_arg_->has_store = true;
     }
     return *this;
 }
 
 ArgParser& ArgParser::StoreValues(std::vector<int>& values) {
-    if (current_arg_ && current_arg_->type == Argument::INT) {
-        current_arg_->store_int_vector = &values;
+    return SetNumericStoreVector(values);
+}
+
+ArgParser& ArgParser::StoreValues(std::vector<int64_t>& values) {
+    return SetNumericStoreVector(values);
+}
+
+ArgParser& ArgParser::StoreValues(std::vector<uint64_t>& values) {
+    return SetNumericStoreVector(values);
+}
+
+ArgParser& ArgParser::StoreValues(std::vector<double>& values) {
+    return SetNumericStoreVector(values);
+}
+
+template <typename T>
+void ArgParser::PushValue(ParseResult& result, ParseResult::ArgumentState& state, const std::function<void(T)>& on_value, T value) {
+    if (on_value) {
+        on_value(value);
+    } else {
+        result.Append(state, value);
     }
-    return *this;
 }
 
-void ArgParser::ResetParserState() {
-    help_ = false;
-    for (Argument& arg : arguments_) {
-        arg.value_provided = false;
-        if (arg.type == Argument::FLAG) {
-            arg.bool_value = arg.has_default ? arg.default_bool_value : false;
-            if (arg.store_bool) {
-                *(arg.store_bool) = arg.bool_value;
-            }
-        } else if (arg.type == Argument::STRING) {
-            arg.string_values.clear();
-            if (arg.store_string) {
-                *(arg.store_string) = "";
+template <typename T>
+bool ArgParser::AppendNumeric(ParseResult& result, ParseResult::ArgumentState& state, const std::function<void(T)>& on_value, std::string_view text) {
+    T value;
+    if (ConvertValue(text, value) != ConvertResult::OK) {
+        return false;
+    }
+    PushValue(result, state, on_value, value);
+    return true;
+}
+
+bool ArgParser::AppendValue(ParseResult& result, const Argument& arg, std::string_view value, size_t position, bool borrowed) const {
+    ParseResult::ArgumentState& state = result.Touch(arg.index);
+    // Deferred only while the token outlives the parse; copying it would cost about as
+    // much as converting it.
+    if (lazy_ && borrowed && !arg.streamed && !arg.has_store && arg.type != Argument::STRING && arg.type != Argument::FLAG
+        && arg.type != Argument::CUSTOM) {
+        state.pending = true;
+        result.pending_types_ |= 1u << arg.type;
+        result.Append(state, ParseResult::PendingValue{value, position});
+        ARGPARSER_STATS(++result.stats_.values_per_argument[arg.index];)
+        ++state.value_count;
+        state.value_provided = true;
+        return true;
+    }
+    ARGPARSER_STATS(size_t capacity_before = result.ArenaCapacity();)
+    const ArgumentDetails& details = DetailsOf(arg);
+    bool converted = true;
+    switch (arg.type) {
+        case Argument::STRING:
+            if (!borrowed && !arg.streamed) {
+                value = result.Retain(value);
             }
-            if (arg.store_string_vector) {
-                arg.store_string_vector->clear();
+            PushValue(result, state, details.on_string_value, value);
+            break;
+        case Argument::INT:
+            converted = AppendNumeric(result, state, details.ints.on_value, value);
+            break;
+        case Argument::INT64:
+            converted = AppendNumeric(result, state, details.int64s.on_value, value);
+            break;
+        case Argument::UINT64:
+            converted = AppendNumeric(result, state, details.uint64s.on_value, value);
+            break;
+        case Argument::DOUBLE:
+            converted = AppendNumeric(result, state, details.doubles.on_value, value);
+            break;
+        case Argument::CUSTOM: {
+            const ValueType& value_type = *details.value_type;
+            converted = value_type.convert(value, result.ReserveCustom(state, 1, value_type.size));
+            state.values.count += converted ? 1 : 0;
+            break;
+        }
+        case Argument::FLAG:
+            break;
+    }
+    ARGPARSER_STATS(
+        if (arg.type != Argument::STRING) {
+            ++result.stats_.conversions;
+            result.stats_.conversion_failures += converted ? 0 : 1;
+        }
+        result.stats_.allocations += result.ArenaCapacity() != capacity_before ? 1 : 0;
+    )
+    if (!converted) {
+        return false;
+    }
+    ARGPARSER_STATS(++result.stats_.values_per_argument[arg.index];)
+    ++state.value_count;
+    state.value_provided = true;
+    return true;
+}
+
+namespace {
+
+constexpr size_t kConversionGrain = 16384;
+
+// Converts tokens into out[0, tokens.size()) in parallel chunks and returns the position
+// of the first token that does not convert, or tokens.size().
+template <typename T>
+size_t ConvertRun(ThreadPool& pool, std::span<const std::string_view> tokens, T* out) {
+    std::atomic<size_t> first_error{tokens.size()};
+    pool.ParallelFor(tokens.size(), kConversionGrain, [&](size_t begin, size_t end) {
+        if (begin > first_error.load(std::memory_order_relaxed)) {
+            return;
+        }
+        for (size_t k = begin; k < end; ++k) {
+            if (ConvertValue(tokens[k], out[k]) != ConvertResult::OK) {
+                size_t seen = first_error.load(std::memory_order_relaxed);
+                while (k < seen && !first_error.compare_exchange_weak(seen, k, std::memory_order_relaxed)) {
+                }
+                return;
             }
-        } else if (arg.type == Argument::INT) {
-            arg.int_values.clear();
-            if (arg.store_int) {
-                *(arg.store_int) = 0;
+        }
+    });
+    return first_error.load();
+}
+
+}
+
+template <typename T>
+size_t ArgParser::AppendConvertedRun(ParseResult& result, ParseResult::ArgumentState& state, std::span<const std::string_view> tokens) const {
+    size_t failed = ConvertRun(Workers(conversion_threads_), tokens, result.Reserve<T>(state, tokens.size()));
+    if (failed == tokens.size()) {
+        state.values.count += tokens.size();
+    }
+    return failed;
+}
+
+bool ArgParser::TakesParallelRun(const Argument& arg, size_t positional_index) const {
+    // Only the last positional takes every remaining value, so the run needs no hand-over.
+    return parallel_conversion_ && !lazy_ && arg.is_multi_value && !arg.streamed && arg.type != Argument::STRING
+        && arg.type != Argument::FLAG && arg.type != Argument::CUSTOM && positional_index + 1 == positional_args_.size();
+}
+
+bool ArgParser::AppendRun(ParseResult& result, const Argument& arg, std::span<const std::string_view> run, size_t offset) const {
+    ParseResult::ArgumentState& state = result.Touch(arg.index);
+    size_t failed = run.size();
+    switch (arg.type) {
+        case Argument::INT:
+            failed = AppendConvertedRun<int>(result, state, run);
+            break;
+        case Argument::INT64:
+            failed = AppendConvertedRun<int64_t>(result, state, run);
+            break;
+        case Argument::UINT64:
+            failed = AppendConvertedRun<uint64_t>(result, state, run);
+            break;
+        case Argument::DOUBLE:
+            failed = AppendConvertedRun<double>(result, state, run);
+            break;
+        case Argument::STRING:
+        case Argument::FLAG:
+        case Argument::CUSTOM:
+            break;
+    }
+    ARGPARSER_STATS(
+        result.stats_.conversions += failed == run.size() ? run.size() : failed + 1;
+        result.stats_.conversion_failures += failed == run.size() ? 0 : 1;
+        ++result.stats_.allocations;
+    )
+    if (failed != run.size()) {
+        return result.Fail(ParseError::INVALID_VALUE, offset + failed, DetailsOf(arg).name);
+    }
+    ARGPARSER_STATS(result.stats_.values_per_argument[arg.index] += run.size();)
+    state.value_count += run.size();
+    state.value_provided = true;
+    return true;
+}
+
+namespace {
+
+constexpr size_t kMaxResponseDepth = 8;
+
+bool IsResponseFile(std::string_view token) {
+    return token.size() > 1 && token[0] == '@';
+}
+
+}
+
+bool ArgParser::ExpandResponseFile(ParseResult& result, std::string_view token, size_t depth, bool& separated) const {
+    std::pmr::vector<std::string_view>& expanded = result.expanded_;
+    size_t start = expanded.size();
+    // The failing token is reported where its contents would have gone in the expansion.
+    auto fail = [&result, &expanded, start, token] {
+        expanded.resize(start);
+        return result.Fail(ParseError::RESPONSE_FILE, start, result.Retain(token.substr(1)));
+    };
+    if (depth >= kMaxResponseDepth) {
+        return fail();
+    }
+    MappedFile file;
+    std::pmr::string path(token.substr(1), expanded.get_allocator());
+    if (!file.Open(path.c_str())) {
+        return fail();
+    }
+    if (!TokenizeResponse(file.Data(), file.Size(), expanded)) {
+        return fail();
+    }
+    result.mappings_.push_back(std::move(file));
+
+    // Files nest rarely, so the file's tokens are only rescanned from the first nested one.
+    size_t nested = start;
+    while (nested < expanded.size() && expanded[nested] != "--" && !IsResponseFile(expanded[nested])) {
+        ++nested;
+    }
+    if (nested == expanded.size()) {
+        return true;
+    }
+    std::pmr::vector<std::string_view> tail(expanded.begin() + nested, expanded.end(), expanded.get_allocator());
+    expanded.resize(nested);
+    for (std::string_view tail_token : tail) {
+        if (!separated && IsResponseFile(tail_token)) {
+            if (!ExpandResponseFile(result, tail_token, depth + 1, separated)) {
+                return false;
             }
-            if (arg.store_int_vector) {
-                arg.store_int_vector->clear();
+            continue;
+        }
+        separated = separated || tail_token == "--";
+        expanded.push_back(tail_token);
+    }
+    return true;
+}
+
+bool ArgParser::ParseTokens(ParseResult& result, std::span<const std::string_view> args, bool borrowed) const {
+    result.Reset(this, arguments_.size());
+    ARGPARSER_STATS(result.stats_.tokens = args.size();)
+
+    bool response_files = response_files_ && result.response_files_;
+    size_t first = 1;
+    while (response_files && first < args.size() && args[first] != "--" && !IsResponseFile(args[first])) {
+        ++first;
+    }
+    bool parsed = true;
+    if (response_files && first < args.size() && args[first] != "--") {
+        // Tokens from the mappings live as long as the result; the others are copied
+        // when the caller's buffer is not borrowed, and dispatch then borrows them all.
+        bool separated = false;
+        for (size_t i = 0; i < args.size() && parsed; ++i) {
+            std::string_view token = args[i];
+            if (i > 0 && !separated && IsResponseFile(token)) {
+                parsed = ExpandResponseFile(result, token, 0, separated);
+                continue;
             }
+            separated = separated || (i > 0 && token == "--");
+            result.expanded_.push_back(borrowed ? token : result.Retain(token));
+        }
+        args = result.expanded_;
+        borrowed = true;
+        ARGPARSER_STATS(result.stats_.tokens = args.size();)
+    }
+
+    if (parsed) {
+        ARGPARSER_STATS(result.phase_clock_.Switch(&result.stats_.dispatch_ns);)
+        parsed = DispatchTokens(result, args, borrowed);
+    }
+    ARGPARSER_STATS(
+        result.phase_clock_.Stop();
+        if (stats_sink_) {
+            stats_sink_->OnParse(result.stats_);
         }
+    )
+    if (parsed && result.subcommand_ != ParseResult::npos) {
+        // Parse fills result_ and writes StoreValue targets, and so does the sub-parser.
+        parsed = ParseSubcommand(result, borrowed, &result == &result_);
     }
+    return parsed;
 }
 
-bool ArgParser::Parse(const std::vector<std::string>& args) {
-    ResetParserState();
+bool ArgParser::ParseSubcommand(ParseResult& result, bool borrowed, bool apply_stores) const {
+    ArgParser& sub = BuildSubcommand(subcommands_[result.subcommand_]);
+    ParseResult& sub_result = apply_stores ? sub.result_ : result.NestedResult();
+    result.subcommand_result_ = &sub_result;
+    sub_result.response_files_ = result.response_files_;
+    ARGPARSER_STATS(sub_result.BeginStats(sub.arguments_.size());)
+    // The name stands in for the program name the sub-parser skips.
+    bool parsed = sub.ParseTokens(sub_result, result.subcommand_args_, borrowed);
+    if (apply_stores) {
+        sub.ApplyStores();
+    }
+    if (!parsed) {
+        result.suggestion_ = sub_result.suggestion_;
+        size_t index = sub_result.error_index_;
+        return result.Fail(sub_result.error_, index == ParseResult::npos ? index : index + result.subcommand_position_,
+                           sub_result.error_argument_);
+    }
+    result.help_ = result.help_ || sub_result.help_;
+    return true;
+}
+
+bool ArgParser::DispatchTokens(ParseResult& result, std::span<const std::string_view> args, bool borrowed) const {
     size_t positional_index = 0;
     size_t i = 1;
+    // End of the last positional run found too short for parallel conversion
+    size_t short_run_end = 0;
 
-
-    for (const auto& pair : name_to_arg_) {
-    }
-    std::cout << std::endl;
+    ClassifyTokens(args, result.token_classes_);
+    std::span<const TokenClass> classes = result.token_classes_;
 
     while (i < args.size()) {
-        const std::string& arg = args[i];
+        std::string_view arg = args[i];
+        const TokenClass& token_class = classes[i];
 
-        if (arg[0] == '-') {
-            if (arg.size() == 1) {
-                return false;
+        if (token_class.kind != TokenClass::POSITIONAL) {
+            if (token_class.kind == TokenClass::DASH) {
+                return result.Fail(ParseError::UNKNOWN_OPTION, i);
             }
-            if (arg[1] == '-') {
-                if (arg.size() == 2) {
+            if (token_class.kind != TokenClass::SHORT_CLUSTER) {
+                if (token_class.kind == TokenClass::TERMINATOR) {
                     ++i;
                     break;
                 }
-                size_t eq_pos = arg.find('=');
-                std::string name, value;
-                if (eq_pos != std::string::npos) {
-                    name = arg.substr(2, eq_pos - 2);
-                    value = arg.substr(eq_pos + 1);
-                } else {
-                    name = arg.substr(2);
-                    value = "";
-                }
-
+                bool has_value = token_class.equals != TokenClass::kNoEquals;
+                std::string_view name = arg.substr(2, has_value ? token_class.equals - 2 : std::string_view::npos);
+                std::string_view value = has_value ? arg.substr(token_class.equals + 1) : std::string_view();
 
-                auto it = name_to_arg_.find(name);
-                if (it != name_to_arg_.end()) {
-                    Argument* arg_ptr = it->second;
-                    if (arg_ptr->type == Argument::FLAG) {
-                        if (!value.empty()) {
-                            return false;
-                        }
-                        arg_ptr->bool_value = true;
-                        arg_ptr->value_provided = true;
-                        if (arg_ptr->store_bool) {
-                            *(arg_ptr->store_bool) = true;
-                        }
-                        if (name == "help") {
-                            help_ = true;
-                        }
-                    } else {
-                        if (value.empty()) {
-                            if (i + 1 < args.size()) {
-                                value = args[++i];
-                            } else {
-                                return false;
-                            }
-                        }
-                        arg_ptr->value_provided = true;
-                        if (arg_ptr->type == Argument::STRING) {
-                            arg_ptr->string_values.push_back(value);
-                            if (arg_ptr->store_string) {
-                                *(arg_ptr->store_string) = value;
-                            }
-                            if (arg_ptr->store_string_vector) {
-                                arg_ptr->store_string_vector->push_back(value);
-                            }
-                        } else if (arg_ptr->type == Argument::INT) {
-                            try {
-                                int int_value = std::stoi(value);
-                                arg_ptr->int_values.push_back(int_value);
-                                if (arg_ptr->store_int) {
-                                    *(arg_ptr->store_int) = int_value;
-                                }
-                                if (arg_ptr->store_int_vector) {
-                                    arg_ptr->store_int_vector->push_back(int_value);
-                                }
-                            } catch (...) {
-                                return false;
-                            }
-                        }
+                ParseError error = ParseError::NONE;
+                std::string_view suggestion;
+                const Argument* arg_ptr = MatchLong(name, error, suggestion);
+                ARGPARSER_STATS(
+                    ++result.stats_.long_lookups;
+                    result.stats_.long_misses += arg_ptr ? 0 : 1;
+                )
+                if (!arg_ptr) {
+                    result.suggestion_ = suggestion;
+                    return result.Fail(error, i, result.Retain(name));
+                }
+                if (arg_ptr->type == Argument::FLAG) {
+                    if (!value.empty()) {
+                        return result.Fail(ParseError::UNEXPECTED_VALUE, i, DetailsOf(*arg_ptr).name);
+                    }
+                    ParseResult::ArgumentState& state = result.Touch(arg_ptr->index);
+                    state.bool_value = true;
+                    state.value_provided = true;
+                    if (arg_ptr->is_help) {
+                        result.help_ = true;
                     }
                 } else {
-                    return false;
+                    if (value.empty()) {
+                        if (i + 1 < args.size()) {
+                            value = args[++i];
+                        } else {
+                            return result.Fail(ParseError::MISSING_VALUE, i, DetailsOf(*arg_ptr).name);
+                        }
+                    }
+                    if (!AppendValue(result, *arg_ptr, value, i, borrowed)) {
+                        return result.Fail(ParseError::INVALID_VALUE, i, DetailsOf(*arg_ptr).name);
+                    }
                 }
             } else {
                 size_t j = 1;
                 while (j < arg.size()) {
-                    char ch = arg[j];
-                    auto it = short_name_to_arg_.find(ch);
-                    if (it != short_name_to_arg_.end()) {
-                        Argument* arg_ptr = it->second;
-                        if (arg_ptr->type == Argument::FLAG) {
-                            arg_ptr->bool_value = true;
-                            arg_ptr->value_provided = true;
-                            if (arg_ptr->store_bool) {
-                                *(arg_ptr->store_bool) = true;
-                            }
-                            if (arg_ptr->name == "help") {
-                                help_ = true;
-                            }
-                            ++j;
-                        } else {
-                            std::string value;
-                            if (j + 1 < arg.size() && arg[j + 1] == '=') {
-                                value = arg.substr(j + 2);
-                                j = arg.size();
-                            } else if (j + 1 < arg.size()) {
-                                value = arg.substr(j + 1);
-                                j = arg.size();
-                            } else {
-                                if (i + 1 < args.size()) {
-                                    value = args[++i];
-                                } else {
-                                    return false;
-                                }
-                            }
-                            arg_ptr->value_provided = true;
-                            if (arg_ptr->type == Argument::STRING) {
-                                arg_ptr->string_values.push_back(value);
-                                if (arg_ptr->store_string) {
-                                    *(arg_ptr->store_string) = value;
-                                }
-                                if (arg_ptr->store_string_vector) {
-                                    arg_ptr->store_string_vector->push_back(value);
-                                }
-                            } else if (arg_ptr->type == Argument::INT) {
-                                try {
-                                    int int_value = std::stoi(value);
-                                    arg_ptr->int_values.push_back(int_value);
-                                    if (arg_ptr->store_int) {
-                                        *(arg_ptr->store_int) = int_value;
-                                    }
-                                    if (arg_ptr->store_int_vector) {
-                                        arg_ptr->store_int_vector->push_back(int_value);
-                                    }
-                                } catch (...) {
-                                    return false;
-                                }
-                            }
-                            break;
+                    const Argument* arg_ptr = FindShort(arg[j]);
+                    ARGPARSER_STATS(
+                        ++result.stats_.short_lookups;
+                        result.stats_.short_misses += arg_ptr ? 0 : 1;
+                    )
+                    if (!arg_ptr) {
+                        return result.Fail(ParseError::UNKNOWN_OPTION, i);
+                    }
+                    if (arg_ptr->type == Argument::FLAG) {
+                        ParseResult::ArgumentState& state = result.Touch(arg_ptr->index);
+                        state.bool_value = true;
+                        state.value_provided = true;
+                        if (arg_ptr->is_help) {
+                            result.help_ = true;
                         }
+                        ++j;
+                        continue;
+                    }
+                    std::string_view value;
+                    if (j + 1 < arg.size() && arg[j + 1] == '=') {
+                        value = arg.substr(j + 2);
+                    } else if (j + 1 < arg.size()) {
+                        value = arg.substr(j + 1);
+                    } else if (i + 1 < args.size()) {
+                        value = args[++i];
                     } else {
-                        return false;
+                        return result.Fail(ParseError::MISSING_VALUE, i, DetailsOf(*arg_ptr).name);
+                    }
+                    if (!AppendValue(result, *arg_ptr, value, i, borrowed)) {
+                        return result.Fail(ParseError::INVALID_VALUE, i, DetailsOf(*arg_ptr).name);
                     }
+                    break;
                 }
             }
         } else {
-            if (positional_index < positional_args_.size()) {
-                Argument* arg_ptr = positional_args_[positional_index];
-                if (arg_ptr->type == Argument::STRING) {
-                    arg_ptr->string_values.push_back(arg);
-                    arg_ptr->value_provided = true;
-                    if (arg_ptr->store_string_vector) {
-                        arg_ptr->store_string_vector->push_back(arg);
-                    }
-                } else if (arg_ptr->type == Argument::INT) {
-                    try {
-                        int int_value = std::stoi(arg);
-                        arg_ptr->int_values.push_back(int_value);
-                        arg_ptr->value_provided = true;
-                        if (arg_ptr->store_int_vector) {
-                            arg_ptr->store_int_vector->push_back(int_value);
-                        }
-                    } catch (...) {
+            if (!subcommands_.empty()) {
+                auto it = subcommand_index_.find(arg);
+                if (it != subcommand_index_.end()) {
+                    result.subcommand_ = it->second;
+                    result.subcommand_position_ = i;
+                    result.subcommand_args_ = args.subspan(i);
+                    i = args.size();
+                    break;
+                }
+                if (positional_index >= positional_args_.size()) {
+                    return result.Fail(ParseError::UNKNOWN_SUBCOMMAND, i);
+                }
+            }
+            if (positional_index >= positional_args_.size()) {
+                return result.Fail(ParseError::UNEXPECTED_POSITIONAL, i);
+            }
+            const Argument* arg_ptr = &arguments_[positional_args_[positional_index]];
+            if (i >= short_run_end && TakesParallelRun(*arg_ptr, positional_index)) {
+                size_t end = i;
+                while (end < args.size() && classes[end].kind == TokenClass::POSITIONAL
+                       && (subcommands_.empty() || !subcommand_index_.contains(args[end]))) {
+                    ++end;
+                }
+                if (end - i >= parallel_min_run_) {
+                    if (!AppendRun(result, *arg_ptr, args.subspan(i, end - i), i)) {
                         return false;
                     }
+                    i = end;
+                    continue;
                 }
-                if (!arg_ptr->is_multi_value) {
+                short_run_end = end;
+            }
+            if (!AppendValue(result, *arg_ptr, arg, i, borrowed)) {
+                return result.Fail(ParseError::INVALID_VALUE, i, DetailsOf(*arg_ptr).name);
+            }
+            if (!arg_ptr->is_multi_value) {
+                ++positional_index;
+            } else if (positional_index != positional_args_.size() - 1) {
+                if (result.states_[arg_ptr->index].ValueCount() >= arg_ptr->min_count) {
                     ++positional_index;
-                } else {
-                    if (positional_index == positional_args_.size() - 1) {
-                    } else {
-                        size_t count = arg_ptr->type == Argument::STRING ? arg_ptr->string_values.size() : arg_ptr->int_values.size();
-                        if (count >= arg_ptr->min_count) {
-                            ++positional_index;
-                        }
-                    }
                 }
-            } else {
-                return false;
             }
         }
         ++i;
     }
 
+    ARGPARSER_STATS(result.phase_clock_.Switch(&result.stats_.positional_ns);)
     while (i < args.size()) {
-        const std::string& arg = args[i];
-        if (positional_index < positional_args_.size()) {
-            Argument* arg_ptr = positional_args_[positional_index];
-            if (arg_ptr->type == Argument::STRING) {
-                arg_ptr->string_values.push_back(arg);
-                arg_ptr->value_provided = true;
-                if (arg_ptr->store_string_vector) {
-                    arg_ptr->store_string_vector->push_back(arg);
-                }
-            } else if (arg_ptr->type == Argument::INT) {
-                try {
-                    int int_value = std::stoi(arg);
-                    arg_ptr->int_values.push_back(int_value);
-                    arg_ptr->value_provided = true;
-                    if (arg_ptr->store_int_vector) {
-                        arg_ptr->store_int_vector->push_back(int_value);
-                    }
-                } catch (...) {
-                    return false;
-                }
-            }
-            if (!arg_ptr->is_multi_value) {
-                ++positional_index;
+        if (positional_index >= positional_args_.size()) {
+            return result.Fail(ParseError::UNEXPECTED_POSITIONAL, i);
+        }
+        const Argument* arg_ptr = &arguments_[positional_args_[positional_index]];
+        if (args.size() - i >= parallel_min_run_ && TakesParallelRun(*arg_ptr, positional_index)) {
+            if (!AppendRun(result, *arg_ptr, args.subspan(i), i)) {
+                return false;
             }
-        } else {
-            return false;
+            break;
+        }
+        if (!AppendValue(result, *arg_ptr, args[i], i, borrowed)) {
+            return result.Fail(ParseError::INVALID_VALUE, i, DetailsOf(*arg_ptr).name);
+        }
+        if (!arg_ptr->is_multi_value) {
+            ++positional_index;
         }
         ++i;
     }
 
-    if (help_) {
-        return true;
-    }
+    ARGPARSER_STATS(result.phase_clock_.Switch(&result.stats_.validation_ns);)
+    return Validate(result);
+}
 
-    for (const Argument& arg : arguments_) {
-        if (arg.type == Argument::STRING) {
-            for (const auto& val : arg.string_values) {
-            }
-        } else if (arg.type == Argument::INT) {
-            for (const auto& val : arg.int_values) {
+bool ArgParser::Validate(ParseResult& result) const {
+    if (result.help_) {
+        for (uint32_t index : validation_args_) {
+            const Argument& arg = arguments_[index];
+            if (arg.type == Argument::FLAG && arg.has_default && !result.states_[index].value_provided) {
+                result.Touch(index).bool_value = DetailsOf(arg).default_bool_value;
             }
-        } else if (arg.type == Argument::FLAG) {
         }
+        return true;
     }
 
-    for (Argument& arg : arguments_) {
-        if (!arg.value_provided) {
+    // Only arguments with a default, Required() or a minimum count need a look here.
+    for (uint32_t index : validation_args_) {
+        const Argument& arg = arguments_[index];
+        if (arg.type == Argument::CUSTOM && arg.has_default && DetailsOf(arg).default_invalid) {
+            return result.Fail(ParseError::INVALID_VALUE, ParseResult::npos, DetailsOf(arg).name);
+        }
+        if (!result.states_[index].value_provided) {
             if (arg.has_default) {
-                arg.value_provided = true;
-                if (arg.type == Argument::STRING) {
-                    arg.string_values.push_back(arg.default_string_value);
-                    if (arg.store_string) {
-                        *(arg.store_string) = arg.default_string_value;
-                    }
-                } else if (arg.type == Argument::INT) {
-                    arg.int_values.push_back(arg.default_int_value);
-                    if (arg.store_int) {
-                        *(arg.store_int) = arg.default_int_value;
-                    }
-                } else if (arg.type == Argument::FLAG) {
-                    arg.bool_value = arg.default_bool_value;
-                    if (arg.store_bool) {
-                        *(arg.store_bool) = arg.default_bool_value;
+                const ArgumentDetails& details = DetailsOf(arg);
+                ParseResult::ArgumentState& state = result.Touch(index);
+                state.value_provided = true;
+                state.from_default = true;
+                state.value_count = 1;
+                switch (arg.type) {
+                    case Argument::STRING:
+                        PushValue<std::string_view>(result, state, details.on_string_value, details.default_string_value);
+                        break;
+                    case Argument::INT:
+                        PushValue(result, state, details.ints.on_value, details.ints.default_value);
+                        break;
+                    case Argument::INT64:
+                        PushValue(result, state, details.int64s.on_value, details.int64s.default_value);
+                        break;
+                    case Argument::UINT64:
+                        PushValue(result, state, details.uint64s.on_value, details.uint64s.default_value);
+                        break;
+                    case Argument::DOUBLE:
+                        PushValue(result, state, details.doubles.on_value, details.doubles.default_value);
+                        break;
+                    case Argument::CUSTOM: {
+                        const ValueType& value_type = *details.value_type;
+                        value_type.convert(details.default_string_value, result.ReserveCustom(state, 1, value_type.size));
+                        ++state.values.count;
+                        break;
                     }
+                    case Argument::FLAG:
+                        state.bool_value = details.default_bool_value;
+                        break;
                 }
             } else if (arg.is_multi_value && arg.min_count == 0) {
             } else if (arg.required) {
-                return false;
+                return result.Fail(ParseError::MISSING_REQUIRED, ParseResult::npos, DetailsOf(arg).name);
             }
+        } else if (arg.is_multi_value && arg.min_count > result.states_[index].ValueCount()) {
+            return result.Fail(ParseError::TOO_FEW_VALUES, ParseResult::npos, DetailsOf(arg).name);
+        }
+    }
+
+    return true;
+}
+
+template <typename T>
+void ArgParser::ApplyNumericStores(const Argument& arg, std::span<const T> values, bool from_default) {
+    const NumericBinding<T>& binding = DetailsOf(arg).Numeric<T>();
+    if (binding.store) {
+        *(binding.store) = values.empty() ? T() : values.back();
+    }
+    if (binding.store_vector) {
+        if (from_default) {
+            binding.store_vector->clear();
         } else {
-            size_t count = arg.type == Argument::STRING ? arg.string_values.size() : arg.int_values.size();
-            if (arg.is_multi_value && arg.min_count > count) {
-                return false;
+            binding.store_vector->assign(values.begin(), values.end());
+        }
+    }
+}
+
+void ArgParser::ResetStores(const Argument& arg) {
+    const ArgumentDetails& details = DetailsOf(arg);
+    switch (arg.type) {
+        case Argument::FLAG:
+            if (details.store_bool) {
+                *(details.store_bool) = arg.has_default ? details.default_bool_value : false;
+            }
+            break;
+        case Argument::STRING:
+            if (details.store_string) {
+                details.store_string->clear();
+            }
+            if (details.store_string_vector) {
+                details.store_string_vector->clear();
+            }
+            break;
+        case Argument::INT:
+            ApplyNumericStores<int>(arg, {}, false);
+            break;
+        case Argument::INT64:
+            ApplyNumericStores<int64_t>(arg, {}, false);
+            break;
+        case Argument::UINT64:
+            ApplyNumericStores<uint64_t>(arg, {}, false);
+            break;
+        case Argument::DOUBLE:
+            ApplyNumericStores<double>(arg, {}, false);
+            break;
+        case Argument::CUSTOM:
+            break;
+    }
+}
+
+void ArgParser::ApplyStores() {
+    // Targets written by the previous parse but not touched by this one go back to empty.
+    for (size_t index : stored_args_) {
+        if (index < result_.states_.size() && !result_.states_[index].touched) {
+            ResetStores(arguments_[index]);
+        }
+    }
+    stored_args_.clear();
+    for (size_t index : result_.touched_) {
+        const Argument& arg = arguments_[index];
+        if (!arg.has_store || arg.streamed) {
+            continue;
+        }
+        stored_args_.push_back(index);
+        const ArgumentDetails& details = DetailsOf(arg);
+        const ParseResult::ArgumentState& state = result_.states_[index];
+        switch (arg.type) {
+            case Argument::FLAG:
+                if (details.store_bool) {
+                    *(details.store_bool) = state.bool_value;
+                }
+                break;
+            case Argument::STRING: {
+                std::span<const std::string_view> values = result_.Values<std::string_view>(state);
+                if (details.store_string) {
+                    if (values.empty()) {
+                        details.store_string->clear();
+                    } else {
+                        details.store_string->assign(values.back());
+                        ARGPARSER_STATS(result_.stats_.bytes_copied += values.back().size();)
+                    }
+                }
+                if (details.store_string_vector) {
+                    if (state.from_default) {
+                        details.store_string_vector->clear();
+                    } else {
+                        details.store_string_vector->assign(values.begin(), values.end());
+                        ARGPARSER_STATS(
+                            for (std::string_view value : values) {
+                                result_.stats_.bytes_copied += value.size();
+                            }
+                        )
+                    }
+                }
+                break;
             }
+            case Argument::INT:
+                ApplyNumericStores(arg, result_.Values<int>(state), state.from_default);
+                break;
+            case Argument::INT64:
+                ApplyNumericStores(arg, result_.Values<int64_t>(state), state.from_default);
+                break;
+            case Argument::UINT64:
+                ApplyNumericStores(arg, result_.Values<uint64_t>(state), state.from_default);
+                break;
+            case Argument::DOUBLE:
+                ApplyNumericStores(arg, result_.Values<double>(state), state.from_default);
+                break;
+            case Argument::CUSTOM:
+                break;
         }
     }
+}
 
-    return true;
+bool ArgParser::Parse(std::span<const std::string_view> args) {
+    ARGPARSER_STATS(result_.BeginStats(arguments_.size());)
+    bool parsed = ParseTokens(result_, args, true);
+    ApplyStores();
+    return parsed;
+}
+
+bool ArgParser::Parse(const std::vector<std::string>& args) {
+    ARGPARSER_STATS(result_.BeginStats(arguments_.size());)
+    bool parsed = ParseTokens(result_, result_.Input(args.begin(), args.end()), false);
+    ApplyStores();
+    return parsed;
 }
 
 bool ArgParser::Parse(int argc, char** argv) {
-    std::vector<std::string> args(argv, argv + argc);
-    return Parse(args);
+    ARGPARSER_STATS(result_.BeginStats(arguments_.size());)
+    bool parsed = ParseTokens(result_, result_.Input(argv, argv + argc), true);
+    ApplyStores();
+    return parsed;
+}
+
+bool ArgParser::ParseInto(ParseResult& result, std::span<const std::string_view> args) const {
+    ARGPARSER_STATS(result.BeginStats(arguments_.size());)
+    return ParseTokens(result, args, true);
+}
+
+bool ArgParser::ParseInto(ParseResult& result, const std::vector<std::string>& args) const {
+    ARGPARSER_STATS(result.BeginStats(arguments_.size());)
+    return ParseTokens(result, result.Input(args.begin(), args.end()), false);
+}
+
+ParseResult ArgParser::ParseToResult(std::span<const std::string_view> args) const {
+    ParseResult result;
+    ParseInto(result, args);
+    return result;
+}
+
+ParseResult ArgParser::ParseToResult(const std::vector<std::string>& args) const {
+    ParseResult result;
+    ParseInto(result, args);
+    return result;
+}
+
+ParseResult ArgParser::ParseToResult(int argc, char** argv) const {
+    ParseResult result;
+    ARGPARSER_STATS(result.BeginStats(arguments_.size());)
+    ParseTokens(result, result.Input(argv, argv + argc), true);
+    return result;
+}
+
+void ArgParser::SetStatsSink(ParseStatsSink* sink) {
+    stats_sink_ = sink;
+}
+
+namespace {
+
+constexpr size_t kBatchGrain = 64;
+
+}
+
+template <typename Line>
+std::vector<ParseResult> ArgParser::ParseLines(std::span<const Line> lines, ThreadPool* pool, size_t threads) const {
+    std::vector<ParseResult> results(lines.size());
+    auto parse = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ParseInto(results[i], lines[i]);
+        }
+    };
+    // A single chunk would only wait for the workers.
+    if (lines.size() <= kBatchGrain) {
+        parse(0, lines.size());
+        return results;
+    }
+    (pool ? *pool : Workers(threads)).ParallelFor(lines.size(), kBatchGrain, parse);
+    return results;
 }
 
+std::vector<ParseResult> ArgParser::ParseBatch(std::span<const std::vector<std::string>> lines, size_t threads) const {
+    return ParseLines(lines, nullptr, threads);
+}
+
+std::vector<ParseResult> ArgParser::ParseBatch(std::span<const std::vector<std::string_view>> lines, size_t threads) const {
+    return ParseLines(lines, nullptr, threads);
+}
+
+std::vector<ParseResult> ArgParser::ParseBatch(std::span<const std::vector<std::string>> lines, ThreadPool& pool) const {
+    return ParseLines(lines, &pool, 0);
+}
+
+std::vector<ParseResult> ArgParser::ParseBatch(std::span<const std::vector<std::string_view>> lines, ThreadPool& pool) const {
+    return ParseLines(lines, &pool, 0);
+}
 
 std::string ArgParser::GetStringValue(const std::string& name) {
     return GetStringValue(name, 0);
 }
 
 std::string ArgParser::GetStringValue(const std::string& name, size_t index) {
-    auto it = name_to_arg_.find(name);
-    if (it != name_to_arg_.end()) {
-        Argument* arg_ptr = it->second;
-        if (index < arg_ptr->string_values.size()) {
-            std::cout << "Returning value: '" << arg_ptr->string_values[index] << "'" << std::endl;
-            return arg_ptr->string_values[index];
-        } else {
-        }
-    } else {
-    }
-    return "";
+    return result_.GetStringValue(name, index);
 }
 
 int ArgParser::GetIntValue(const std::string& name) {
@@ -503,29 +1210,43 @@ int ArgParser::GetIntValue(const std::string& name) {
 }
 
 int ArgParser::GetIntValue(const std::string& name, size_t index) {
-    auto it = name_to_arg_.find(name);
-    if (it != name_to_arg_.end()) {
-        Argument* arg_ptr = it->second;
-        if (index < arg_ptr->int_values.size()) {
-            return arg_ptr->int_values[index];
-        } else {
-        }
-    } else {
-    }
-    return 0;
+    return result_.GetIntValue(name, index);
+}
+
+int64_t ArgParser::GetInt64Value(const std::string& name) {
+    return GetInt64Value(name, 0);
+}
+
+int64_t ArgParser::GetInt64Value(const std::string& name, size_t index) {
+    return result_.GetInt64Value(name, index);
+}
+
+uint64_t ArgParser::GetUInt64Value(const std::string& name) {
+    return GetUInt64Value(name, 0);
+}
+
+uint64_t ArgParser::GetUInt64Value(const std::string& name, size_t index) {
+    return result_.GetUInt64Value(name, index);
+}
+
+double ArgParser::GetDoubleValue(const std::string& name) {
+    return GetDoubleValue(name, 0);
+}
+
+double ArgParser::GetDoubleValue(const std::string& name, size_t index) {
+    return result_.GetDoubleValue(name, index);
 }
 
 bool ArgParser::GetFlag(const std::string& name) {
-    auto it = name_to_arg_.find(name);
-    if (it != name_to_arg_.end()) {
-        Argument* arg_ptr = it->second;
-        return arg_ptr->bool_value;
-    }
-    return false;
+    return result_.GetFlag(name);
 }
 
 bool ArgParser::Help() const {
-    return help_;
+    return result_.Help();
+}
+
+const ParseResult& ArgParser::Result() const {
+    return result_;
 }
 
 std::string ArgParser::HelpDescription() const {
@@ -536,23 +1257,41 @@ std::string ArgParser::HelpDescription() const {
     }
     oss << "\n";
     for (const Argument& arg : arguments_) {
+        const ArgumentDetails& details = DetailsOf(arg);
         oss << "  ";
         if (arg.short_name) {
             oss << "-" << arg.short_name << ", ";
         } else {
             oss << "    ";
         }
-        oss << "--" << arg.name;
+        oss << "--" << details.name;
         if (arg.type != Argument::FLAG) {
             oss << "=<";
-            if (arg.type == Argument::STRING) {
-                oss << "string";
-            } else if (arg.type == Argument::INT) {
-                oss << "int";
+            switch (arg.type) {
+                case Argument::STRING:
+                    oss << "string";
+                    break;
+                case Argument::INT:
+                    oss << "int";
+                    break;
+                case Argument::INT64:
+                    oss << "int64";
+                    break;
+                case Argument::UINT64:
+                    oss << "uint64";
+                    break;
+                case Argument::DOUBLE:
+                    oss << "double";
+                    break;
+                case Argument::CUSTOM:
+                    oss << details.value_type->name;
+                    break;
+                case Argument::FLAG:
+                    break;
             }
             oss << ">";
         }
-        oss << ", " << arg.help;
+        oss << ", " << details.help;
         if (arg.is_multi_value) {
             oss << " [repeated";
             if (arg.min_count > 0) {
@@ -562,17 +1301,42 @@ std::string ArgParser::HelpDescription() const {
         }
         if (arg.has_default) {
             oss << " [default = ";
-            if (arg.type == Argument::STRING) {
-                oss << arg.default_string_value;
-            } else if (arg.type == Argument::INT) {
-                oss << arg.default_int_value;
-            } else if (arg.type == Argument::FLAG) {
-                oss << (arg.default_bool_value ? "true" : "false");
+            switch (arg.type) {
+                case Argument::STRING:
+                case Argument::CUSTOM:
+                    oss << details.default_string_value;
+                    break;
+                case Argument::INT:
+                    oss << details.ints.default_value;
+                    break;
+                case Argument::INT64:
+                    oss << details.int64s.default_value;
+                    break;
+                case Argument::UINT64:
+                    oss << details.uint64s.default_value;
+                    break;
+                case Argument::DOUBLE:
+                    oss << details.doubles.default_value;
+                    break;
+                case Argument::FLAG:
+                    oss << (details.default_bool_value ? "true" : "false");
+                    break;
             }
             oss << "]";
         }
         oss << "\n";
     }
+    // Listed from the registrations alone; no sub-parser is built for the help text.
+    if (!subcommands_.empty()) {
+        oss << "\nSubcommands:\n";
+        for (const SubcommandEntry& entry : subcommands_) {
+            oss << "  " << entry.name;
+            if (!entry.help.empty()) {
+                oss << ", " << entry.help;
+            }
+            oss << "\n";
+        }
+    }
     return oss.str();
 }
 
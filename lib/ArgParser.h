@@ -1,16 +1,60 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <span>
 #include <vector>
+#include <deque>
 #include <map>
-#include <list>
+#include <memory>
+#include <mutex>
+#include <array>
+#include <functional>
+#include <unordered_map>
+#include <type_traits>
+
+#include "ParseResult.h"
+#include "OptionTrie.h"
+#include "ParseStats.h"
+#include "PerfectHash.h"
+#include "ValueConverter.h"
+#include "ValueTypes.h"
 
 namespace ArgumentParser {
 
+class ThreadPool;
+
+// One row of a static option table for ArgParser::AddArguments, meant for designated
+// initializers:
+//     constexpr ArgSpec kOptions[] = {
+//         {.type = ArgSpec::INT, .short_name = 'l', .name = "level", .default_value = "3", .has_default = true},
+//         {.type = ArgSpec::STRING, .name = "Files", .multi_value = true, .positional = true},
+//     };
+struct ArgSpec {
+    enum Type : uint8_t { STRING, INT, FLAG, INT64, UINT64, DOUBLE };
+
+    Type type = STRING;
+    char short_name = '\0';
+    std::string_view name{};
+    std::string_view help{};
+    // Converted like a command-line value; "true" or "false" for flags
+    std::string_view default_value{};
+    bool has_default = false;
+    bool multi_value = false;
+    uint32_t min_count = 0;
+    bool positional = false;
+    bool required = false;
+};
+
 class ArgParser {
 public:
+    using SubcommandFactory = std::function<void(ArgParser&)>;
+
     ArgParser(const std::string& program_name);
+    // Result() and the getters use a ParseResult allocating from resource; see ParseResult.
+    ArgParser(const std::string& program_name, std::pmr::memory_resource* resource);
 
     // Add argument methods
     ArgParser& AddStringArgument(const std::string& name, const std::string& help = "");
@@ -19,14 +63,55 @@ public:
     ArgParser& AddIntArgument(const std::string& name, const std::string& help = "");
     ArgParser& AddIntArgument(char short_name, const std::string& name, const std::string& help = "");
 
+    ArgParser& AddInt64Argument(const std::string& name, const std::string& help = "");
+    ArgParser& AddInt64Argument(char short_name, const std::string& name, const std::string& help = "");
+
+    ArgParser& AddUInt64Argument(const std::string& name, const std::string& help = "");
+    ArgParser& AddUInt64Argument(char short_name, const std::string& name, const std::string& help = "");
+
+    ArgParser& AddDoubleArgument(const std::string& name, const std::string& help = "");
+    ArgParser& AddDoubleArgument(char short_name, const std::string& name, const std::string& help = "");
+
     ArgParser& AddFlag(const std::string& name, const std::string& help = "");
     ArgParser& AddFlag(char short_name, const std::string& name, const std::string& help = "");
 
     ArgParser& AddHelp(char short_name, const std::string& name, const std::string& description);
 
+    // Registers a whole table at once: storage is reserved up front and the name lookup
+    // is filled from one sorted pass. Equivalent to the matching Add*Argument calls with
+    // their modifiers; StoreValue and OnValue still go through the single-argument API.
+    // False if a default does not convert, in which case that argument has none.
+    bool AddArguments(std::span<const ArgSpec> specs);
+
+    // Argument of any value type with ValueTraits, e.g. std::chrono::nanoseconds,
+    // ByteSize, Endpoint or an enum with EnumNames; Traits overrides the conversion.
+    // Values are read through Handle<T>() or GetValue<T>(name); Default takes the text
+    // form and is ignored if it does not convert. StoreValue, OnValue and
+    // LazyConversion() do not apply to these arguments.
+    template <typename T, typename Traits = ValueTraits<T>>
+    ArgParser& AddArgument(const std::string& name, const std::string& help = "") {
+        return AddArgument<T, Traits>('\0', name, help);
+    }
+    template <typename T, typename Traits = ValueTraits<T>>
+    ArgParser& AddArgument(char short_name, const std::string& name, const std::string& help = "") {
+        static_assert(!kBuiltinValue<T>, "built-in types have their own Add*Argument");
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= kMaxValueSize && alignof(T) <= kMaxValueAlign,
+                      "values are copied bytewise into the result");
+        AddArgument(Argument::CUSTOM, short_name, name, help);
+        DetailsOf(*current_arg_).value_type = &kValueType<T, Traits>;
+        return *this;
+    }
+
     // Modifiers
+    // Text default of string and AddArgument<T> arguments. An AddArgument<T> default that
+    // does not convert makes every Parse fail with INVALID_VALUE for that argument.
     ArgParser& Default(const std::string& value);
+    ArgParser& Default(const char* value);
+    // An int default is also accepted by the 64-bit and double arguments.
     ArgParser& Default(int value);
+    ArgParser& Default(int64_t value);
+    ArgParser& Default(uint64_t value);
+    ArgParser& Default(double value);
     ArgParser& Default(bool value);
 
     ArgParser& MultiValue(size_t min_count = 0);
@@ -34,60 +119,349 @@ public:
     ArgParser& Required();
     ArgParser& StoreValue(std::string& value);
     ArgParser& StoreValue(int& value);
+    ArgParser& StoreValue(int64_t& value);
+    ArgParser& StoreValue(uint64_t& value);
+    ArgParser& StoreValue(double& value);
     ArgParser& StoreValue(bool& value);
     ArgParser& StoreValues(std::vector<std::string>& values);
     ArgParser& StoreValues(std::vector<int>& values);
+    ArgParser& StoreValues(std::vector<int64_t>& values);
+    ArgParser& StoreValues(std::vector<uint64_t>& values);
+    ArgParser& StoreValues(std::vector<double>& values);
+
+    // Hands every value of the argument added last to callback as soon as it is converted,
+    // instead of collecting it; the result keeps only the number of values, which is enough
+    // for Required() and MultiValue(min_count). The callback receives a std::string_view
+    // for string arguments (valid during the call only) and the value type otherwise; one
+    // that does not accept it is ignored. Its StoreValue targets are no longer written.
+    // Parses sharing the parser from several threads call it concurrently.
+    template <typename F>
+    ArgParser& OnValue(F callback) {
+        if (!current_arg_) {
+            return *this;
+        }
+        switch (current_arg_->type) {
+            case Argument::STRING:
+                BindValueCallback(DetailsOf(*current_arg_).on_string_value, callback);
+                break;
+            case Argument::INT:
+                BindValueCallback(DetailsOf(*current_arg_).ints.on_value, callback);
+                break;
+            case Argument::INT64:
+                BindValueCallback(DetailsOf(*current_arg_).int64s.on_value, callback);
+                break;
+            case Argument::UINT64:
+                BindValueCallback(DetailsOf(*current_arg_).uint64s.on_value, callback);
+                break;
+            case Argument::DOUBLE:
+                BindValueCallback(DetailsOf(*current_arg_).doubles.on_value, callback);
+                break;
+            case Argument::FLAG:
+            case Argument::CUSTOM:
+                break;
+        }
+        return *this;
+    }
+
+    // Registers a subcommand. The first non-option token naming it hands the rest of the
+    // line to a sub-parser, which factory fills in when a parse first needs it; the
+    // parent's own options go before the name. Lookup by name is a single hash probe.
+    ArgParser& AddSubcommand(const std::string& name, SubcommandFactory factory, const std::string& help = "");
+    // Sub-parser of name, built now if no parse has needed it yet; nullptr if unknown.
+    ArgParser* Subcommand(std::string_view name);
+    // Name of the subcommand the last Parse handed the line to, empty if none.
+    std::string_view SelectedSubcommand() const;
+
+    // Typed handle to the argument added last, or an invalid handle if T does not match
+    // its type.
+    template <typename T>
+    ArgHandle<T> Handle() const {
+        if (current_arg_ && current_arg_->type == kTypeOf<T>
+            && (kBuiltinValue<T> || DetailsOf(*current_arg_).value_type->id == &kValueTypeId<T>)) {
+            return ArgHandle<T>(current_arg_->index);
+        }
+        return ArgHandle<T>();
+    }
+
+    // Compiles the registered options into flat lookup tables used by Parse and the
+    // getters. Adding an argument afterwards drops back to the trie lookups.
+    ArgParser& Freeze();
+    bool Frozen() const;
+
+    // Makes Parse only record the tokens of numeric values; each argument is converted on
+    // its first read and cached. Applies to borrowed input (argv, string_view spans,
+    // response files) and to arguments without StoreValue or OnValue. Conversion errors
+    // surface through ValidateAll(); until then a value that does not convert reads as 0.
+    ArgParser& LazyConversion(bool enabled = true);
+    // Converts everything deferred by the last Parse; false with INVALID_VALUE on error.
+    bool ValidateAll();
+
+    // Lets Parse replace an `@path` token with the whitespace-separated tokens of that
+    // file (quotes and backslashes as in a shell, nested files up to 8 deep). The file is
+    // memory-mapped and split in place; its values are views into the mapping, which the
+    // result keeps open until its next parse. Tokens after `--` are never expanded, and
+    // error indices count the expanded tokens.
+    ArgParser& ResponseFiles(bool enabled = true);
+
+    // Accepts any unambiguous prefix of a long option (`--verb` for `--verbose`); an exact
+    // name always wins, and a prefix of several names fails with AMBIGUOUS_OPTION.
+    ArgParser& Abbreviations(bool enabled = true);
+
+    // Converts runs of at least min_run positional tokens for a trailing numeric
+    // MultiValue() positional in parallel chunks on a pool of `threads` workers (0: one
+    // per core). Values keep their order; an invalid token is reported at its position,
+    // and a subcommand name ends the run. The pool starts with the first run long enough.
+    ArgParser& ParallelConversion(size_t threads = 0, size_t min_run = 65536);
 
     // Parsing methods
+    // argv and std::string_view inputs are borrowed: parsed string values point into
+    // the caller's buffer, which must outlive the getters. std::string inputs are copied
+    // only where a string value has to be kept.
     bool Parse(int argc, char** argv);
     bool Parse(const std::vector<std::string>& args);
+    bool Parse(std::span<const std::string_view> args);
+
+    // Parses into a separate result without touching the parser or any StoreValue
+    // target, so one (preferably frozen) parser can serve many threads at once.
+    bool ParseInto(ParseResult& result, std::span<const std::string_view> args) const;
+    bool ParseInto(ParseResult& result, const std::vector<std::string>& args) const;
+    ParseResult ParseToResult(std::span<const std::string_view> args) const;
+    ParseResult ParseToResult(const std::vector<std::string>& args) const;
+    ParseResult ParseToResult(int argc, char** argv) const;
+
+    // Parses independent command lines on a work-stealing pool of `threads` workers
+    // (0: one per core). results[i] belongs to lines[i] and carries its own error status.
+    // The pool is the parser's own, started by the first batch or parallel conversion
+    // that needs it and kept for later ones, which then ignore `threads`. Batches of up
+    // to 64 lines are parsed on the calling thread.
+    std::vector<ParseResult> ParseBatch(std::span<const std::vector<std::string>> lines, size_t threads = 0) const;
+    std::vector<ParseResult> ParseBatch(std::span<const std::vector<std::string_view>> lines, size_t threads = 0) const;
+    // Same on a pool owned by the caller
+    std::vector<ParseResult> ParseBatch(std::span<const std::vector<std::string>> lines, ThreadPool& pool) const;
+    std::vector<ParseResult> ParseBatch(std::span<const std::vector<std::string_view>> lines, ThreadPool& pool) const;
+
+    // Receives ParseStats after every parse; only active in builds with
+    // ARGPARSER_ENABLE_STATS. Pass nullptr to detach.
+    void SetStatsSink(ParseStatsSink* sink);
+
+    // Result of the last Parse call
+    const ParseResult& Result() const;
 
     // Getters
     std::string GetStringValue(const std::string& name);
     std::string GetStringValue(const std::string& name, size_t index);
     int GetIntValue(const std::string& name);
     int GetIntValue(const std::string& name, size_t index);
+    int64_t GetInt64Value(const std::string& name);
+    int64_t GetInt64Value(const std::string& name, size_t index);
+    uint64_t GetUInt64Value(const std::string& name);
+    uint64_t GetUInt64Value(const std::string& name, size_t index);
+    double GetDoubleValue(const std::string& name);
+    double GetDoubleValue(const std::string& name, size_t index);
     bool GetFlag(const std::string& name);
 
+    template <typename T>
+    decltype(auto) Get(ArgHandle<T> handle) const {
+        return result_.Get(handle);
+    }
+    template <typename T>
+    decltype(auto) Get(ArgHandle<T> handle, size_t index) const {
+        return result_.Get(handle, index);
+    }
+    template <typename T>
+    decltype(auto) GetAll(ArgHandle<T> handle) const {
+        return result_.GetAll(handle);
+    }
+    template <typename T>
+    T GetValue(const std::string& name, size_t index = 0) const {
+        return result_.template GetValue<T>(name, index);
+    }
+
     std::string HelpDescription() const;
     bool Help() const;
 
 private:
-    // Internal methods
-    void ResetParserState();
+    friend class ParseResult;
+    friend class CommandServer;
+    friend class StreamParser;
+    friend class Snapshot;
+
+    template <typename T>
+    struct NumericBinding {
+        T default_value{};
+        T* store = nullptr;
+        std::vector<T>* store_vector = nullptr;
+        std::function<void(T)> on_value;
+    };
 
+    // Fields read for every token; kept small and contiguous.
     struct Argument {
-        enum Type { STRING, INT, FLAG } type;
-        std::string name;
+        enum Type : uint8_t { STRING, INT, FLAG, INT64, UINT64, DOUBLE, CUSTOM } type = STRING;
         char short_name = '\0';
-        std::string help;
         bool is_positional = false;
         bool is_multi_value = false;
-        size_t min_count = 0;
         bool has_default = false;
         bool required = false;
+        bool validated = false;
+        bool has_store = false;
+        bool streamed = false;
+        bool is_help = false;
+        uint32_t index = 0;
+        uint32_t min_count = 0;
+    };
+
+    // Everything else about an argument, indexed like arguments_.
+    struct ArgumentDetails {
+        std::string name;
+        std::string help;
         std::string default_string_value;
-        int default_int_value = 0;
         bool default_bool_value = false;
-        bool value_provided = false;
-        std::vector<std::string> string_values;
-        std::vector<int> int_values;
-        bool bool_value = false;
+        // AddArgument<T> default text that does not convert; every Parse then fails.
+        bool default_invalid = false;
+        NumericBinding<int> ints;
+        NumericBinding<int64_t> int64s;
+        NumericBinding<uint64_t> uint64s;
+        NumericBinding<double> doubles;
         bool* store_bool = nullptr;
         std::string* store_string = nullptr;
-        int* store_int = nullptr;
         std::vector<std::string>* store_string_vector = nullptr;
-        std::vector<int>* store_int_vector = nullptr;
+        std::function<void(std::string_view)> on_string_value;
+        // Conversion of a CUSTOM argument
+        const ValueType* value_type = nullptr;
+
+        template <typename T>
+        NumericBinding<T>& Numeric() {
+            if constexpr (std::is_same_v<T, int>) {
+                return ints;
+            } else if constexpr (std::is_same_v<T, int64_t>) {
+                return int64s;
+            } else if constexpr (std::is_same_v<T, uint64_t>) {
+                return uint64s;
+            } else {
+                return doubles;
+            }
+        }
+
+        template <typename T>
+        const NumericBinding<T>& Numeric() const {
+            return const_cast<ArgumentDetails*>(this)->Numeric<T>();
+        }
     };
 
+    // The parser itself is created on first use; once_flag keeps concurrent ParseInto
+    // calls from building it twice.
+    struct SubcommandEntry {
+        std::string name;
+        std::string help;
+        SubcommandFactory factory;
+        std::unique_ptr<ArgParser> parser;
+        std::once_flag built;
+    };
+
+    static_assert(static_cast<int>(ArgSpec::DOUBLE) == static_cast<int>(Argument::DOUBLE)
+                  && static_cast<int>(ArgSpec::FLAG) == static_cast<int>(Argument::FLAG), "ArgSpec::Type mirrors Argument::Type");
+
+    template <typename T>
+    static constexpr Argument::Type kNumericType = std::is_same_v<T, int> ? Argument::INT
+        : std::is_same_v<T, int64_t> ? Argument::INT64
+        : std::is_same_v<T, uint64_t> ? Argument::UINT64 : Argument::DOUBLE;
+
+    template <typename T>
+    static constexpr Argument::Type kTypeOf = std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> ? Argument::STRING
+        : std::is_same_v<T, bool> ? Argument::FLAG : !kBuiltinValue<T> ? Argument::CUSTOM : kNumericType<T>;
+
+    ArgumentDetails& DetailsOf(const Argument& arg) {
+        return details_[arg.index];
+    }
+    const ArgumentDetails& DetailsOf(const Argument& arg) const {
+        return details_[arg.index];
+    }
+
+    ArgParser& AddArgument(Argument::Type type, char short_name, const std::string& name, const std::string& help);
+    bool SetDefaultText(const Argument& arg, ArgumentDetails& details, std::string_view text);
+    template <typename T>
+    ArgParser& SetNumericDefault(T value);
+    template <typename T>
+    ArgParser& SetNumericStore(T& value);
+    template <typename T>
+    ArgParser& SetNumericStoreVector(std::vector<T>& values);
+    template <typename T, typename F>
+    void BindValueCallback(std::function<void(T)>& target, F& callback) {
+        if constexpr (std::is_invocable_v<F&, T>) {
+            target = callback;
+            current_arg_->streamed = true;
+        }
+    }
+    template <typename T>
+    void ApplyNumericStores(const Argument& arg, std::span<const T> values, bool from_default);
+
+    const Argument* FindLong(std::string_view name) const;
+    const Argument* FindShort(char short_name) const;
+    // FindLong plus Abbreviations(). On a miss sets error, and suggestion to the nearest
+    // registered name for UNKNOWN_OPTION.
+    const Argument* MatchLong(std::string_view name, ParseError& error, std::string_view& suggestion) const;
+    bool ParseTokens(ParseResult& result, std::span<const std::string_view> args, bool borrowed) const;
+    bool ExpandResponseFile(ParseResult& result, std::string_view token, size_t depth, bool& separated) const;
+    bool TakesParallelRun(const Argument& arg, size_t positional_index) const;
+    bool AppendRun(ParseResult& result, const Argument& arg, std::span<const std::string_view> run, size_t offset) const;
+    bool DispatchTokens(ParseResult& result, std::span<const std::string_view> args, bool borrowed) const;
+    // Applies defaults and checks Required() and minimum counts once all tokens are in.
+    bool Validate(ParseResult& result) const;
+    ArgParser& BuildSubcommand(SubcommandEntry& entry) const;
+    bool ParseSubcommand(ParseResult& result, bool borrowed, bool apply_stores) const;
+    // A streamed value goes to the callback and is not kept.
+    template <typename T>
+    static void PushValue(ParseResult& result, ParseResult::ArgumentState& state, const std::function<void(T)>& on_value, T value);
+    template <typename T>
+    static bool AppendNumeric(ParseResult& result, ParseResult::ArgumentState& state, const std::function<void(T)>& on_value, std::string_view text);
+    template <typename T>
+    size_t AppendConvertedRun(ParseResult& result, ParseResult::ArgumentState& state, std::span<const std::string_view> tokens) const;
+    bool AppendValue(ParseResult& result, const Argument& arg, std::string_view value, size_t position, bool borrowed) const;
+    void TrackValidation(Argument& arg);
+    void ResetStores(const Argument& arg);
+    void ApplyStores();
+
     std::string program_name_;
     std::string help_description_;
-    bool help_ = false;
-    std::list<Argument> arguments_;
-    std::map<std::string, Argument*> name_to_arg_;
-    std::map<char, Argument*> short_name_to_arg_;
-    std::vector<Argument*> positional_args_;
+    std::vector<Argument> arguments_;
+    std::vector<ArgumentDetails> details_;
+    // Arguments with a default, Required() or MultiValue(n > 0), by ascending index
+    std::vector<uint32_t> validation_args_;
+    // Arguments whose StoreValue targets the last Parse wrote
+    std::vector<size_t> stored_args_;
+    // Long names to argument indices; the lookup until Freeze, and for prefixes and
+    // suggestions after it
+    OptionTrie long_names_;
+    std::map<char, uint32_t> short_name_to_arg_;
+    std::vector<uint32_t> positional_args_;
+    // A deque keeps the entries in place, so the map can key on their names.
+    mutable std::deque<SubcommandEntry> subcommands_;
+    std::unordered_map<std::string_view, uint32_t> subcommand_index_;
+    // Points into arguments_, so it is only valid until the next Add* call
     Argument* current_arg_ = nullptr;
+    bool frozen_ = false;
+    bool response_files_ = false;
+    bool lazy_ = false;
+    bool abbreviations_ = false;
+    // Started by the first parse that needs it; created keeps concurrent parses from
+    // starting two. Copies of the parser share it.
+    struct WorkerPool {
+        std::once_flag created;
+        std::shared_ptr<ThreadPool> pool;
+    };
+    ThreadPool& Workers(size_t threads) const;
+    // pool may be null, then Workers(threads) runs the batch.
+    template <typename Line>
+    std::vector<ParseResult> ParseLines(std::span<const Line> lines, ThreadPool* pool, size_t threads) const;
+    std::shared_ptr<WorkerPool> workers_ = std::make_shared<WorkerPool>();
+    bool parallel_conversion_ = false;
+    size_t conversion_threads_ = 0;
+    size_t parallel_min_run_ = 0;
+    PerfectHash long_table_;
+    std::vector<const Argument*> long_table_args_;
+    std::array<const Argument*, 256> short_table_{};
+    ParseResult result_;
+    ParseStatsSink* stats_sink_ = nullptr;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,409 @@
+#include "CommandServer.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+
+namespace ArgumentParser {
+
+namespace {
+
+constexpr uint32_t kNoIndex = UINT32_MAX;
+// Frames above this are refused and the connection dropped.
+constexpr uint32_t kMaxFrame = 64u << 20;
+constexpr uint32_t kMaxTokens = 1u << 20;
+// A client has this long from connecting to send its whole request.
+constexpr std::chrono::milliseconds kRequestTimeout{2000};
+// Waiting reads wake up at this interval so Stop() does not wait for clients.
+constexpr std::chrono::milliseconds kPollInterval{100};
+
+// Bounds a server-side read: it fails once stop is set or the deadline has passed.
+struct ReadLimit {
+    const std::atomic<bool>& stop;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+bool WaitReadable(int fd, const ReadLimit& limit) {
+    pollfd entry{fd, POLLIN, 0};
+    while (!limit.stop.load()) {
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(limit.deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return false;
+        }
+        int ready = ::poll(&entry, 1, static_cast<int>(std::min(left, kPollInterval).count()));
+        if (ready > 0) {
+            return true;
+        }
+        if (ready < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool MakeAddress(const std::string& path, sockaddr_un& address) {
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.data(), path.size());
+    return true;
+}
+
+bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool ReadAll(int fd, char* data, size_t size, const ReadLimit* limit = nullptr) {
+    while (size > 0) {
+        if (limit && !WaitReadable(fd, *limit)) {
+            return false;
+        }
+        ssize_t received = ::recv(fd, data, size, 0);
+        if (received == 0) {
+            return false;
+        }
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+bool ReadFrame(int fd, std::string& payload, const ReadLimit* limit = nullptr) {
+    uint32_t size;
+    if (!ReadAll(fd, reinterpret_cast<char*>(&size), sizeof(size), limit) || size > kMaxFrame) {
+        return false;
+    }
+    payload.resize(size);
+    return ReadAll(fd, payload.data(), size, limit);
+}
+
+void AppendU32(std::string& out, uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendString(std::string& out, std::string_view value) {
+    AppendU32(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+template <typename T>
+void AppendNumbers(std::string& out, std::span<const T> values) {
+    AppendU32(out, static_cast<uint32_t>(values.size()));
+    for (T value : values) {
+        char text[32];
+        auto [end, ec] = std::to_chars(text, text + sizeof(text), value);
+        AppendString(out, std::string_view(text, ec == std::errc() ? end - text : 0));
+    }
+}
+
+// Reads from a payload; every call fails once the payload is exhausted.
+class PayloadReader {
+public:
+    explicit PayloadReader(std::string_view payload) : rest_(payload) {}
+
+    bool U8(uint8_t& value) {
+        if (rest_.empty()) {
+            return false;
+        }
+        value = static_cast<uint8_t>(rest_[0]);
+        rest_.remove_prefix(1);
+        return true;
+    }
+
+    bool U32(uint32_t& value) {
+        if (rest_.size() < sizeof(value)) {
+            return false;
+        }
+        std::memcpy(&value, rest_.data(), sizeof(value));
+        rest_.remove_prefix(sizeof(value));
+        return true;
+    }
+
+    bool String(std::string_view& value) {
+        uint32_t size;
+        if (!U32(size) || rest_.size() < size) {
+            return false;
+        }
+        value = rest_.substr(0, size);
+        rest_.remove_prefix(size);
+        return true;
+    }
+
+private:
+    std::string_view rest_;
+};
+
+// Values of one parse level, then its subcommand name and, if any, the subcommand's level.
+bool ReadValues(PayloadReader& reader, CommandReply& reply) {
+    uint32_t argument_count;
+    if (!reader.U32(argument_count)) {
+        return false;
+    }
+    reply.values.clear();
+    for (uint32_t i = 0; i < argument_count; ++i) {
+        std::string_view name;
+        uint32_t value_count;
+        if (!reader.String(name) || !reader.U32(value_count)) {
+            return false;
+        }
+        auto& [entry_name, values] = reply.values.emplace_back();
+        entry_name = name;
+        for (uint32_t j = 0; j < value_count; ++j) {
+            std::string_view value;
+            if (!reader.String(value)) {
+                return false;
+            }
+            values.emplace_back(value);
+        }
+    }
+    std::string_view subcommand;
+    if (!reader.String(subcommand)) {
+        return false;
+    }
+    reply.subcommand = subcommand;
+    reply.subcommand_reply.reset();
+    if (subcommand.empty()) {
+        return true;
+    }
+    reply.subcommand_reply = std::make_unique<CommandReply>();
+    return ReadValues(reader, *reply.subcommand_reply);
+}
+
+}
+
+CommandServer::CommandServer(const ArgParser& parser, size_t threads)
+    : parser_(parser),
+      threads_(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      help_text_(parser.HelpDescription()) {}
+
+CommandServer::~CommandServer() {
+    Stop();
+}
+
+bool CommandServer::Start(const std::string& path) {
+    sockaddr_un address;
+    if (listen_fd_ >= 0 || !MakeAddress(path, address)) {
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    ::unlink(path.c_str());
+    // Only the owner may connect. Linux creates the socket file with the mode set on the
+    // socket; the chmod covers systems that take it from the umask instead.
+    if (::fchmod(fd, S_IRUSR | S_IWUSR) != 0
+        || ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || ::chmod(path.c_str(), S_IRUSR | S_IWUSR) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        ::close(fd);
+        return false;
+    }
+    listen_fd_ = fd;
+    path_ = path;
+    stopping_ = false;
+    workers_.reserve(threads_);
+    for (size_t i = 0; i < threads_; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+    return true;
+}
+
+void CommandServer::Stop() {
+    if (listen_fd_ < 0) {
+        return;
+    }
+    stopping_ = true;
+    // Wakes the workers blocked in accept.
+    ::shutdown(listen_fd_, SHUT_RDWR);
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    ::unlink(path_.c_str());
+}
+
+void CommandServer::WorkerLoop() {
+    ParseResult result;
+    result.response_files_ = false;
+    std::string buffer;
+    std::vector<std::string_view> args;
+    std::string reply;
+    while (!stopping_) {
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+        // One request per connection, so a slow or idle client only holds its worker
+        // until the deadline.
+        ServeRequest(fd, result, buffer, args, reply);
+        ::close(fd);
+    }
+}
+
+bool CommandServer::ServeRequest(int fd, ParseResult& result, std::string& buffer, std::vector<std::string_view>& args,
+                                 std::string& reply) const {
+    ReadLimit limit{stopping_, std::chrono::steady_clock::now() + kRequestTimeout};
+    if (!ReadFrame(fd, buffer, &limit)) {
+        return false;
+    }
+    PayloadReader reader(buffer);
+    uint32_t count;
+    if (!reader.U32(count) || count > kMaxTokens) {
+        return false;
+    }
+    args.resize(count);
+    for (std::string_view& token : args) {
+        if (!reader.String(token)) {
+            return false;
+        }
+    }
+    // Tokens view into buffer, which stays put until the reply is written.
+    if (parser_.ParseInto(result, args)) {
+        // Reports what LazyConversion() deferred; AppendValues converts every level.
+        result.ValidateAll();
+    }
+
+    reply.assign(sizeof(uint32_t), '\0');
+    reply.push_back(static_cast<char>(result.Error()));
+    reply.push_back(result.Help() ? 1 : 0);
+    size_t error_index = result.ErrorIndex();
+    AppendU32(reply, error_index == ParseResult::npos ? kNoIndex : static_cast<uint32_t>(error_index));
+    AppendString(reply, result.ErrorArgument());
+    AppendString(reply, result.Suggestion());
+    AppendString(reply, result.Help() ? std::string_view(help_text_) : std::string_view());
+
+    AppendValues(reply, result);
+    uint32_t payload_size = static_cast<uint32_t>(reply.size() - sizeof(uint32_t));
+    std::memcpy(reply.data(), &payload_size, sizeof(payload_size));
+    return WriteAll(fd, reply.data(), reply.size());
+}
+
+void CommandServer::AppendValues(std::string& reply, const ParseResult& result) {
+    const ArgParser& parser = *result.parser_;
+    size_t count_offset = reply.size();
+    AppendU32(reply, 0);
+    uint32_t argument_count = 0;
+    for (size_t index : result.touched_) {
+        const ArgParser::Argument& arg = parser.arguments_[index];
+        const ParseResult::ArgumentState& state = result.states_[index];
+        if (arg.type == ArgParser::Argument::CUSTOM || !state.value_provided) {
+            continue;
+        }
+        AppendString(reply, parser.DetailsOf(arg).name);
+        ++argument_count;
+        switch (arg.type) {
+            case ArgParser::Argument::STRING: {
+                std::span<const std::string_view> values = result.Values<std::string_view>(state);
+                AppendU32(reply, static_cast<uint32_t>(values.size()));
+                for (std::string_view value : values) {
+                    AppendString(reply, value);
+                }
+                break;
+            }
+            case ArgParser::Argument::FLAG:
+                AppendU32(reply, 1);
+                AppendString(reply, state.bool_value ? "true" : "false");
+                break;
+            case ArgParser::Argument::INT:
+                AppendNumbers(reply, result.Materialize<int>(state) ? result.Values<int>(state) : std::span<const int>());
+                break;
+            case ArgParser::Argument::INT64:
+                AppendNumbers(reply, result.Materialize<int64_t>(state) ? result.Values<int64_t>(state) : std::span<const int64_t>());
+                break;
+            case ArgParser::Argument::UINT64:
+                AppendNumbers(reply, result.Materialize<uint64_t>(state) ? result.Values<uint64_t>(state) : std::span<const uint64_t>());
+                break;
+            case ArgParser::Argument::DOUBLE:
+                AppendNumbers(reply, result.Materialize<double>(state) ? result.Values<double>(state) : std::span<const double>());
+                break;
+            case ArgParser::Argument::CUSTOM:
+                break;
+        }
+    }
+    std::memcpy(reply.data() + count_offset, &argument_count, sizeof(argument_count));
+    AppendString(reply, result.Subcommand());
+    if (result.SubcommandResult()) {
+        AppendValues(reply, *result.SubcommandResult());
+    }
+}
+
+bool SendCommand(const std::string& path, std::span<const std::string_view> args, CommandReply& reply) {
+    sockaddr_un address;
+    if (!MakeAddress(path, address)) {
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    std::string frame(sizeof(uint32_t), '\0');
+    AppendU32(frame, static_cast<uint32_t>(args.size()));
+    for (std::string_view token : args) {
+        AppendString(frame, token);
+    }
+    uint32_t payload_size = static_cast<uint32_t>(frame.size() - sizeof(uint32_t));
+    std::memcpy(frame.data(), &payload_size, sizeof(payload_size));
+
+    std::string payload;
+    bool received = WriteAll(fd, frame.data(), frame.size()) && ReadFrame(fd, payload);
+    ::close(fd);
+    if (!received) {
+        return false;
+    }
+
+    PayloadReader reader(payload);
+    uint8_t error;
+    uint8_t help;
+    uint32_t error_index;
+    std::string_view error_argument;
+    std::string_view suggestion;
+    std::string_view help_text;
+    if (!reader.U8(error) || !reader.U8(help) || !reader.U32(error_index) || !reader.String(error_argument)
+        || !reader.String(suggestion) || !reader.String(help_text)) {
+        return false;
+    }
+    reply.error = static_cast<ParseError>(error);
+    reply.help = help != 0;
+    reply.error_index = error_index == kNoIndex ? ParseResult::npos : error_index;
+    reply.error_argument = error_argument;
+    reply.suggestion = suggestion;
+    reply.help_text = help_text;
+    return ReadValues(reader, reply);
+}
+
+}
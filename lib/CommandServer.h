@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ArgParser.h"
+#include "ParseResult.h"
+
+namespace ArgumentParser {
+
+// Frames on the socket, integers in host byte order since both ends share the machine:
+//   frame:    u32 payload size, payload
+//   request:  u32 token count, then per token a string; token 0 is the program name
+//   reply:    u8 ParseError, u8 help, u32 error index (UINT32_MAX for none), string error
+//             argument, string suggestion, string help text (empty unless help was asked
+//             for), values
+//   values:   u32 argument count, then per argument its name, u32 value count and the
+//             values; then the subcommand name, followed by its own values unless empty
+//   string:   u32 length, bytes
+// Values travel as text: numbers as by std::to_chars, flags as true/false. Values of
+// AddArgument<T> types have no text form and are left out.
+struct CommandReply {
+    ParseError error = ParseError::NONE;
+    bool help = false;
+    size_t error_index = ParseResult::npos;
+    std::string error_argument;
+    std::string suggestion;
+    std::string help_text;
+    std::vector<std::pair<std::string, std::vector<std::string>>> values;
+    // Selected subcommand and the values of its own arguments, null if none
+    std::string subcommand;
+    std::unique_ptr<CommandReply> subcommand_reply;
+};
+
+// Keeps a parser schema warm in one process and parses command lines sent by clients
+// over a Unix domain socket. Each worker blocks in accept on the shared socket, serves
+// one request per connection and reuses one ParseResult and its buffers throughout, so a
+// warmed-up server parses without allocating. A client that has not sent its request
+// within 2 s is dropped. @file tokens are never expanded, even with ResponseFiles(), so
+// clients cannot read files through the server. OnValue callbacks of the schema run in
+// the server.
+class CommandServer {
+public:
+    // The parser should be frozen and must outlive the server. 0 threads means one
+    // worker per core.
+    explicit CommandServer(const ArgParser& parser, size_t threads = 0);
+    ~CommandServer();
+
+    CommandServer(const CommandServer&) = delete;
+    CommandServer& operator=(const CommandServer&) = delete;
+
+    // Binds path with mode 0600, replacing a stale socket file, and starts the workers.
+    bool Start(const std::string& path);
+    // Stops accepting, waits for the workers and removes the socket file.
+    void Stop();
+
+private:
+    void WorkerLoop();
+    bool ServeRequest(int fd, ParseResult& result, std::string& buffer, std::vector<std::string_view>& args,
+                      std::string& reply) const;
+    static void AppendValues(std::string& reply, const ParseResult& result);
+
+    const ArgParser& parser_;
+    size_t threads_;
+    std::string help_text_;
+    std::string path_;
+    int listen_fd_ = -1;
+    std::atomic<bool> stopping_{false};
+    std::vector<std::thread> workers_;
+};
+
+// Client side: sends one command line to the server at path and reads its reply.
+// False if the server cannot be reached or the reply is malformed.
+bool SendCommand(const std::string& path, std::span<const std::string_view> args, CommandReply& reply);
+
+}
@@ -0,0 +1,130 @@
+#include "OptionTrie.h"
+
+#include <algorithm>
+
+namespace ArgumentParser {
+
+void OptionTrie::Reserve(size_t nodes) {
+    // The root comes with the first key.
+    nodes_.reserve(std::max<size_t>(nodes_.size(), 1) + nodes);
+}
+
+void OptionTrie::Clear() {
+    nodes_.clear();
+    max_length_ = 0;
+}
+
+void OptionTrie::Insert(std::string_view key, uint32_t value) {
+    if (nodes_.empty()) {
+        nodes_.emplace_back();
+    }
+    uint32_t existing = Walk(key);
+    bool added = existing == npos || nodes_[existing].value == npos;
+    uint32_t node = 0;
+    for (unsigned char c : key) {
+        if (added) {
+            ++nodes_[node].count;
+        }
+        nodes_[node].last = value;
+        uint32_t previous = npos;
+        uint32_t child = nodes_[node].first_child;
+        while (child != npos && nodes_[child].label < c) {
+            previous = child;
+            child = nodes_[child].next_sibling;
+        }
+        if (child == npos || nodes_[child].label != c) {
+            // Linked between previous and child so siblings stay sorted
+            uint32_t created = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back().label = c;
+            nodes_[created].next_sibling = child;
+            if (previous == npos) {
+                nodes_[node].first_child = created;
+            } else {
+                nodes_[previous].next_sibling = created;
+            }
+            child = created;
+        }
+        node = child;
+    }
+    if (added) {
+        ++nodes_[node].count;
+    }
+    nodes_[node].last = value;
+    nodes_[node].value = value;
+    max_length_ = std::max(max_length_, key.size());
+}
+
+uint32_t OptionTrie::Walk(std::string_view key) const {
+    if (nodes_.empty()) {
+        return npos;
+    }
+    uint32_t node = 0;
+    for (unsigned char c : key) {
+        uint32_t child = nodes_[node].first_child;
+        while (child != npos && nodes_[child].label < c) {
+            child = nodes_[child].next_sibling;
+        }
+        if (child == npos || nodes_[child].label != c) {
+            return npos;
+        }
+        node = child;
+    }
+    return node;
+}
+
+uint32_t OptionTrie::Find(std::string_view key) const {
+    uint32_t node = Walk(key);
+    return node == npos ? npos : nodes_[node].value;
+}
+
+uint32_t OptionTrie::FindPrefix(std::string_view key, bool* ambiguous) const {
+    *ambiguous = false;
+    uint32_t node = key.empty() ? npos : Walk(key);
+    if (node == npos) {
+        return npos;
+    }
+    const Node& found = nodes_[node];
+    if (found.value != npos || found.count == 1) {
+        return found.value != npos ? found.value : found.last;
+    }
+    *ambiguous = found.count > 1;
+    return npos;
+}
+
+uint32_t OptionTrie::Nearest(std::string_view key, size_t max_distance) const {
+    if (nodes_.empty()) {
+        return npos;
+    }
+    Search search{key, std::vector<size_t>((max_length_ + 1) * (key.size() + 1)), max_distance + 1, npos};
+    for (size_t j = 0; j <= key.size(); ++j) {
+        search.rows[j] = j;
+    }
+    Visit(search, 0, 0);
+    return search.best_value;
+}
+
+void OptionTrie::Visit(Search& search, uint32_t node, size_t depth) const {
+    const size_t width = search.key.size() + 1;
+    const size_t* previous = &search.rows[depth * width];
+    size_t* row = &search.rows[(depth + 1) * width];
+    for (uint32_t child = nodes_[node].first_child; child != npos; child = nodes_[child].next_sibling) {
+        const unsigned char c = nodes_[child].label;
+        row[0] = depth + 1;
+        size_t row_min = row[0];
+        for (size_t j = 1; j < width; ++j) {
+            size_t cost = static_cast<unsigned char>(search.key[j - 1]) == c ? 0 : 1;
+            row[j] = std::min({previous[j] + 1, row[j - 1] + 1, previous[j - 1] + cost});
+            row_min = std::min(row_min, row[j]);
+        }
+        if (nodes_[child].value != npos && row[width - 1] < search.best_distance) {
+            search.best_distance = row[width - 1];
+            search.best_value = nodes_[child].value;
+        }
+        // Distances only grow along a path, so nothing below can beat the best.
+        if (row_min < search.best_distance) {
+            Visit(search, child, depth + 1);
+        }
+    }
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ArgumentParser {
+
+// Byte trie over long option names, stored as one array of first-child / next-sibling
+// nodes with siblings sorted by byte. Every node counts the keys below it, so a prefix
+// resolves to a single key without walking its subtree. Lookups read the key bytes in
+// place and do not allocate.
+class OptionTrie {
+public:
+    static constexpr uint32_t npos = static_cast<uint32_t>(-1);
+
+    // Maps key to value; inserting a key again replaces its value.
+    void Insert(std::string_view key, uint32_t value);
+    // Makes room for nodes more nodes on top of those already stored.
+    void Reserve(size_t nodes);
+    void Clear();
+
+    uint32_t Find(std::string_view key) const;
+    // Value of key, or of the only key key is a prefix of. npos if there is none, with
+    // *ambiguous set when several keys start with key.
+    uint32_t FindPrefix(std::string_view key, bool* ambiguous) const;
+    // Value of the key nearest to key by edit distance, at most max_distance; the first
+    // in byte order wins a tie. Prunes every subtree that cannot get under the best so far.
+    uint32_t Nearest(std::string_view key, size_t max_distance) const;
+
+    size_t Size() const { return nodes_.empty() ? 0 : nodes_[0].count; }
+
+private:
+    struct Node {
+        uint32_t first_child = npos;
+        uint32_t next_sibling = npos;
+        uint32_t value = npos;
+        // Keys ending in this subtree, and the value of the last one inserted, which is
+        // the only one when count is 1.
+        uint32_t count = 0;
+        uint32_t last = npos;
+        unsigned char label = 0;
+    };
+
+    struct Search {
+        std::string_view key;
+        // One edit-distance row per depth, key.size() + 1 entries each
+        std::vector<size_t> rows;
+        size_t best_distance;
+        uint32_t best_value = npos;
+    };
+
+    uint32_t Walk(std::string_view key) const;
+    void Visit(Search& search, uint32_t node, size_t depth) const;
+
+    std::vector<Node> nodes_;
+    size_t max_length_ = 0;
+};
+
+}
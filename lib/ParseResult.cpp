@@ -0,0 +1,420 @@
+#include "ParseResult.h"
+#include "ArgParser.h"
+
+namespace ArgumentParser {
+
+ParseResult::ParseResult(std::pmr::memory_resource* resource)
+    : states_(resource),
+      touched_(resource),
+      string_arena_(resource),
+      int_arena_(resource),
+      int64_arena_(resource),
+      uint64_arena_(resource),
+      double_arena_(resource),
+      pending_arena_(resource),
+      custom_arena_(resource),
+      owned_values_(resource),
+      mappings_(resource),
+      expanded_(resource),
+      input_(resource),
+      token_classes_(resource) {}
+
+ParseResult& ParseResult::operator=(ParseResult&& other) {
+    if (this == &other) {
+        return *this;
+    }
+    bool same_resource = states_.get_allocator() == other.states_.get_allocator();
+    std::vector<const char*> owned;
+    if (!same_resource) {
+        owned.reserve(other.owned_count_);
+        for (size_t k = 0; k < other.owned_count_; ++k) {
+            owned.push_back(other.owned_values_[k].data());
+        }
+    }
+    const std::string_view* input = other.input_.data();
+    const std::string_view* expanded = other.expanded_.data();
+
+    parser_ = other.parser_;
+    states_ = std::move(other.states_);
+    touched_ = std::move(other.touched_);
+    string_arena_ = std::move(other.string_arena_);
+    int_arena_ = std::move(other.int_arena_);
+    int64_arena_ = std::move(other.int64_arena_);
+    uint64_arena_ = std::move(other.uint64_arena_);
+    double_arena_ = std::move(other.double_arena_);
+    pending_arena_ = std::move(other.pending_arena_);
+    pending_types_ = other.pending_types_;
+    custom_arena_ = std::move(other.custom_arena_);
+    owned_values_ = std::move(other.owned_values_);
+    owned_count_ = other.owned_count_;
+    mappings_ = std::move(other.mappings_);
+    expanded_ = std::move(other.expanded_);
+    input_ = std::move(other.input_);
+    token_classes_ = std::move(other.token_classes_);
+    subcommand_ = other.subcommand_;
+    subcommand_position_ = other.subcommand_position_;
+    subcommand_args_ = other.subcommand_args_;
+    subcommand_result_ = other.subcommand_result_;
+    nested_ = std::move(other.nested_);
+    help_ = other.help_;
+    response_files_ = other.response_files_;
+    error_ = other.error_;
+    error_index_ = other.error_index_;
+    error_argument_ = other.error_argument_;
+    suggestion_ = other.suggestion_;
+#ifdef ARGPARSER_ENABLE_STATS
+    stats_ = std::move(other.stats_);
+#endif
+    if (!same_resource) {
+        RebaseViews(owned, input, expanded);
+    }
+    return *this;
+}
+
+void ParseResult::RebaseViews(const std::vector<const char*>& owned, const std::string_view* input,
+                              const std::string_view* expanded) {
+    // Owned strings by old address, to find the one a view starts in
+    std::vector<size_t> order(owned.size());
+    for (size_t k = 0; k < order.size(); ++k) {
+        order[k] = k;
+    }
+    std::sort(order.begin(), order.end(), [&owned](size_t a, size_t b) {
+        return std::less<const char*>()(owned[a], owned[b]);
+    });
+    auto rebase = [&](std::string_view& view) {
+        auto it = std::upper_bound(order.begin(), order.end(), view.data(), [&owned](const char* data, size_t k) {
+            return std::less<const char*>()(data, owned[k]);
+        });
+        if (it == order.begin()) {
+            return;
+        }
+        size_t k = *(it - 1);
+        size_t offset = static_cast<size_t>(view.data() - owned[k]);
+        if (offset + view.size() <= owned_values_[k].size()) {
+            view = std::string_view(owned_values_[k].data() + offset, view.size());
+        }
+    };
+    for (std::string_view& view : string_arena_) {
+        rebase(view);
+    }
+    rebase(error_argument_);
+
+    auto rebase_tokens = [this](const std::string_view* old_data, const std::pmr::vector<std::string_view>& tokens) {
+        const std::string_view* first = subcommand_args_.data();
+        if (!subcommand_args_.empty() && !std::less<const std::string_view*>()(first, old_data)
+            && std::less<const std::string_view*>()(first, old_data + tokens.size())) {
+            subcommand_args_ = std::span<const std::string_view>(tokens.data() + (first - old_data), subcommand_args_.size());
+            return true;
+        }
+        return false;
+    };
+    if (!rebase_tokens(input, input_)) {
+        rebase_tokens(expanded, expanded_);
+    }
+}
+
+void ParseResult::Reset(const ArgParser* parser, size_t argument_count) {
+    for (size_t index : touched_) {
+        states_[index].Clear();
+    }
+    touched_.clear();
+    string_arena_.clear();
+    int_arena_.clear();
+    int64_arena_.clear();
+    uint64_arena_.clear();
+    double_arena_.clear();
+    pending_arena_.clear();
+    pending_types_ = 0;
+    custom_arena_.clear();
+    if (parser_ != parser) {
+        parser_ = parser;
+        states_.assign(argument_count, ArgumentState());
+    } else if (states_.size() != argument_count) {
+        states_.resize(argument_count);
+    }
+    owned_count_ = 0;
+    mappings_.clear();
+    expanded_.clear();
+    subcommand_ = npos;
+    subcommand_position_ = 0;
+    subcommand_args_ = {};
+    subcommand_result_ = nullptr;
+    help_ = false;
+    error_ = ParseError::NONE;
+    error_index_ = npos;
+    error_argument_ = {};
+    suggestion_ = {};
+}
+
+ParseResult::ArgumentState& ParseResult::Touch(size_t index) {
+    ArgumentState& state = states_[index];
+    if (!state.touched) {
+        state.touched = true;
+        touched_.push_back(index);
+    }
+    return state;
+}
+
+std::string_view ParseResult::Retain(std::string_view value) {
+    // Strings are reused across parses; a deque never moves them, so views stay valid.
+    if (owned_count_ == owned_values_.size()) {
+        owned_values_.emplace_back();
+    }
+    std::pmr::string& owned = owned_values_[owned_count_++];
+    ARGPARSER_STATS(
+        stats_.allocations += owned.capacity() < value.size() ? 1 : 0;
+        stats_.bytes_copied += value.size();
+    )
+    owned.assign(value);
+    return owned;
+}
+
+void ParseResult::BeginStats(size_t argument_count) {
+    ARGPARSER_STATS(
+        stats_ = ParseStats();
+        stats_.values_per_argument.assign(argument_count, 0);
+        phase_clock_.Switch(&stats_.tokenize_ns);
+    )
+    static_cast<void>(argument_count);
+}
+
+const ParseStats* ParseResult::Stats() const {
+#ifdef ARGPARSER_ENABLE_STATS
+    return &stats_;
+#else
+    return nullptr;
+#endif
+}
+
+size_t ParseResult::ArenaCapacity() const {
+    return string_arena_.capacity() + int_arena_.capacity() + int64_arena_.capacity() + uint64_arena_.capacity()
+        + double_arena_.capacity() + pending_arena_.capacity() + custom_arena_.capacity();
+}
+
+ParseResult& ParseResult::NestedResult() {
+    if (!nested_) {
+        nested_ = std::make_unique<ParseResult>(states_.get_allocator().resource());
+    }
+    return *nested_;
+}
+
+std::string_view ParseResult::Subcommand() const {
+    return subcommand_ == npos ? std::string_view() : parser_->subcommands_[subcommand_].name;
+}
+
+const ParseResult* ParseResult::SubcommandResult() const {
+    return subcommand_result_;
+}
+
+bool ParseResult::Fail(ParseError error, size_t index, std::string_view argument) {
+    error_ = error;
+    error_index_ = index;
+    error_argument_ = argument;
+    return false;
+}
+
+template <typename T>
+bool ParseResult::Materialize(const ArgumentState& state, size_t* failed_position) const {
+    if constexpr (!std::is_same_v<T, std::string_view>) {
+        if (pending_types_ & (1u << ArgParser::kTypeOf<T>)) {
+            const_cast<ParseResult*>(this)->ConvertPending<T>();
+        }
+    }
+    if (state.failed && failed_position) {
+        *failed_position = state.failed_position;
+    }
+    return !state.failed;
+}
+
+template <typename T>
+void ParseResult::ConvertPending() {
+    pending_types_ &= ~(1u << ArgParser::kTypeOf<T>);
+    std::pmr::vector<T>& arena = Arena<T>();
+    size_t total = 0;
+    for (size_t index : touched_) {
+        if (states_[index].pending && parser_->arguments_[index].type == ArgParser::kTypeOf<T>) {
+            total += states_[index].values.count;
+        }
+    }
+    arena.reserve(arena.size() + total);
+    for (size_t index : touched_) {
+        ArgumentState& state = states_[index];
+        if (!state.pending || parser_->arguments_[index].type != ArgParser::kTypeOf<T>) {
+            continue;
+        }
+        ValueSlice raw_slice = state.values;
+        state.values = ValueSlice();
+        state.pending = false;
+        T* out = Reserve<T>(state, raw_slice.count);
+        for (size_t k = 0; k < raw_slice.count; ++k) {
+            const PendingValue& raw = pending_arena_[raw_slice.first + k];
+            if (ConvertValue(raw.text, out[k]) != ConvertResult::OK) {
+                // The slice is the tail of the arena, so its room goes back.
+                arena.resize(state.values.first);
+                state.values = ValueSlice();
+                state.failed = true;
+                state.failed_position = raw.position;
+                break;
+            }
+        }
+        if (!state.failed) {
+            state.values.count = raw_slice.count;
+        }
+    }
+}
+
+template bool ParseResult::Materialize<std::string_view>(const ArgumentState&, size_t*) const;
+template bool ParseResult::Materialize<int>(const ArgumentState&, size_t*) const;
+template bool ParseResult::Materialize<int64_t>(const ArgumentState&, size_t*) const;
+template bool ParseResult::Materialize<uint64_t>(const ArgumentState&, size_t*) const;
+template bool ParseResult::Materialize<double>(const ArgumentState&, size_t*) const;
+
+bool ParseResult::ValidateAll() {
+    if (!Ok()) {
+        return false;
+    }
+    ConvertPending<int>();
+    ConvertPending<int64_t>();
+    ConvertPending<uint64_t>();
+    ConvertPending<double>();
+    for (size_t index : touched_) {
+        const ArgumentState& state = states_[index];
+        if (state.failed) {
+            return Fail(ParseError::INVALID_VALUE, state.failed_position, parser_->details_[index].name);
+        }
+    }
+    return true;
+}
+
+bool ParseResult::Ok() const {
+    return parser_ && error_ == ParseError::NONE;
+}
+
+ParseResult::operator bool() const {
+    return Ok();
+}
+
+ParseError ParseResult::Error() const {
+    return error_;
+}
+
+size_t ParseResult::ErrorIndex() const {
+    return error_index_;
+}
+
+std::string_view ParseResult::ErrorArgument() const {
+    return error_argument_;
+}
+
+std::string_view ParseResult::Suggestion() const {
+    return suggestion_;
+}
+
+const ParseResult::ArgumentState* ParseResult::FindState(const std::string& name) const {
+    if (!parser_) {
+        return nullptr;
+    }
+    const ArgParser::Argument* arg_ptr = parser_->FindLong(name);
+    if (!arg_ptr || arg_ptr->index >= states_.size()) {
+        return nullptr;
+    }
+    return &states_[arg_ptr->index];
+}
+
+const ParseResult::ArgumentState* ParseResult::FindCustomState(const std::string& name, const void* type_id) const {
+    if (!parser_) {
+        return nullptr;
+    }
+    const ArgParser::Argument* arg_ptr = parser_->FindLong(name);
+    if (!arg_ptr || arg_ptr->index >= states_.size()) {
+        return nullptr;
+    }
+    const ValueType* value_type = parser_->details_[arg_ptr->index].value_type;
+    return value_type && value_type->id == type_id ? &states_[arg_ptr->index] : nullptr;
+}
+
+std::string ParseResult::GetStringValue(const std::string& name) const {
+    return GetStringValue(name, 0);
+}
+
+template <typename T>
+std::span<const T> ParseResult::FindValues(const std::string& name) const {
+    if (!parser_) {
+        return {};
+    }
+    const ArgParser::Argument* arg_ptr = parser_->FindLong(name);
+    if (!arg_ptr || arg_ptr->index >= states_.size() || arg_ptr->type != ArgParser::kTypeOf<T>) {
+        return {};
+    }
+    const ArgumentState& state = states_[arg_ptr->index];
+    return Materialize<T>(state) ? Values<T>(state) : std::span<const T>();
+}
+
+std::string ParseResult::GetStringValue(const std::string& name, size_t index) const {
+    std::span<const std::string_view> values = FindValues<std::string_view>(name);
+    return index < values.size() ? std::string(values[index]) : std::string();
+}
+
+template <typename T>
+T ParseResult::GetNumericValue(const std::string& name, size_t index) const {
+    std::span<const T> values = FindValues<T>(name);
+    return index < values.size() ? values[index] : T();
+}
+
+int ParseResult::GetIntValue(const std::string& name) const {
+    return GetIntValue(name, 0);
+}
+
+int ParseResult::GetIntValue(const std::string& name, size_t index) const {
+    return GetNumericValue<int>(name, index);
+}
+
+int64_t ParseResult::GetInt64Value(const std::string& name) const {
+    return GetInt64Value(name, 0);
+}
+
+int64_t ParseResult::GetInt64Value(const std::string& name, size_t index) const {
+    return GetNumericValue<int64_t>(name, index);
+}
+
+uint64_t ParseResult::GetUInt64Value(const std::string& name) const {
+    return GetUInt64Value(name, 0);
+}
+
+uint64_t ParseResult::GetUInt64Value(const std::string& name, size_t index) const {
+    return GetNumericValue<uint64_t>(name, index);
+}
+
+double ParseResult::GetDoubleValue(const std::string& name) const {
+    return GetDoubleValue(name, 0);
+}
+
+double ParseResult::GetDoubleValue(const std::string& name, size_t index) const {
+    return GetNumericValue<double>(name, index);
+}
+
+bool ParseResult::GetFlag(const std::string& name) const {
+    const ArgumentState* state = FindState(name);
+    return state ? state->bool_value : false;
+}
+
+bool ParseResult::Help() const {
+    return help_;
+}
+
+std::string_view ParseResult::Get(ArgHandle<std::string> handle, size_t index) const {
+    std::span<const std::string_view> values = GetAll(handle);
+    return index < values.size() ? values[index] : std::string_view();
+}
+
+bool ParseResult::Get(ArgHandle<bool> handle) const {
+    const ArgumentState* state = StateOf(handle.index_);
+    return state ? state->bool_value : false;
+}
+
+std::span<const std::string_view> ParseResult::GetAll(ArgHandle<std::string> handle) const {
+    const ArgumentState* state = StateOf(handle.index_);
+    return state ? Values<std::string_view>(*state) : std::span<const std::string_view>();
+}
+
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "ParseStats.h"
+#include "ResponseFile.h"
+#include "TokenClassifier.h"
+#include "ValueTypes.h"
+#include "ValueConverter.h"
+
+namespace ArgumentParser {
+
+class ArgParser;
+class ParseResult;
+
+// Typed reference to one argument, obtained from ArgParser::Handle<T>() right after the
+// argument is added. T is std::string, int, int64_t, uint64_t, double, bool or the type
+// of an AddArgument<T> argument. Reads
+// through a handle index the result directly: no name lookup, no copy.
+template <typename T>
+class ArgHandle {
+public:
+    ArgHandle() = default;
+
+    bool Valid() const {
+        return index_ != static_cast<size_t>(-1);
+    }
+
+private:
+    friend class ArgParser;
+    friend class ParseResult;
+
+    explicit ArgHandle(size_t index) : index_(index) {}
+
+    size_t index_ = static_cast<size_t>(-1);
+};
+
+enum class ParseError {
+    NONE,
+    UNKNOWN_OPTION,
+    MISSING_VALUE,
+    INVALID_VALUE,
+    UNEXPECTED_VALUE,
+    UNEXPECTED_POSITIONAL,
+    MISSING_REQUIRED,
+    TOO_FEW_VALUES,
+    RESPONSE_FILE,
+    UNKNOWN_SUBCOMMAND,
+    AMBIGUOUS_OPTION,
+};
+
+// Values produced by one parse against an ArgParser schema. The schema is only read while
+// parsing, so any number of results can be filled from one parser concurrently. A result
+// refers to its parser and must not outlive it.
+//
+// Several threads may read one result at once, except after a parse with
+// ArgParser::LazyConversion(): there the first read of each numeric type converts the
+// deferred values of that type in place, so call ValidateAll() before sharing it.
+class ParseResult {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    ParseResult() = default;
+    // Every container the parse fills (states, value arenas, copied strings, argv views,
+    // response-file tokens) allocates from resource, which must outlive the result.
+    // Capacity is kept between parses, so a warmed-up result parses without allocating.
+    explicit ParseResult(std::pmr::memory_resource* resource);
+    ParseResult(ParseResult&& other) = default;
+    // Keeps this result's memory resource. When other uses a different one, its strings
+    // are moved one by one, and every view into them is pointed at the new copies.
+    ParseResult& operator=(ParseResult&& other);
+
+    bool Ok() const;
+    explicit operator bool() const;
+    ParseError Error() const;
+    // Index of the offending token in the parsed arguments, npos for errors found after
+    // all tokens were consumed (missing required argument, too few values).
+    size_t ErrorIndex() const;
+    // Long name of the argument the error refers to, empty if there is none. For an
+    // unknown or ambiguous long option it is the name as given.
+    std::string_view ErrorArgument() const;
+    // Registered long name nearest to an unknown long option, empty if none is close.
+    std::string_view Suggestion() const;
+
+    std::string GetStringValue(const std::string& name) const;
+    std::string GetStringValue(const std::string& name, size_t index) const;
+    int GetIntValue(const std::string& name) const;
+    int GetIntValue(const std::string& name, size_t index) const;
+    int64_t GetInt64Value(const std::string& name) const;
+    int64_t GetInt64Value(const std::string& name, size_t index) const;
+    uint64_t GetUInt64Value(const std::string& name) const;
+    uint64_t GetUInt64Value(const std::string& name, size_t index) const;
+    double GetDoubleValue(const std::string& name) const;
+    double GetDoubleValue(const std::string& name, size_t index) const;
+    bool GetFlag(const std::string& name) const;
+    bool Help() const;
+
+    // Name of the subcommand the line was handed to, empty if none.
+    std::string_view Subcommand() const;
+    // Values of the subcommand's own arguments, nullptr if none was selected. Error
+    // indices of the subcommand are reported here, counted from the start of the line.
+    const ParseResult* SubcommandResult() const;
+
+    // Figures of the parse that filled this result, nullptr unless the library is built
+    // with ARGPARSER_ENABLE_STATS.
+    const ParseStats* Stats() const;
+
+    // Handle access; out of range indices give an empty view or a zero value.
+    std::string_view Get(ArgHandle<std::string> handle, size_t index = 0) const;
+    bool Get(ArgHandle<bool> handle) const;
+    template <typename T>
+    const T& Get(ArgHandle<T> handle, size_t index = 0) const {
+        static const T kEmpty{};
+        std::span<const T> values = GetAll(handle);
+        return index < values.size() ? values[index] : kEmpty;
+    }
+
+    std::span<const std::string_view> GetAll(ArgHandle<std::string> handle) const;
+    template <typename T>
+    std::span<const T> GetAll(ArgHandle<T> handle) const {
+        const ArgumentState* state = StateOf(handle.index_);
+        if constexpr (!kBuiltinValue<T>) {
+            return state ? CustomValues<T>(*state) : std::span<const T>();
+        } else {
+            return state && Materialize<T>(*state) ? Values<T>(*state) : std::span<const T>();
+        }
+    }
+
+    // Value of an AddArgument<T> argument by name; T() if the name is unknown, the index
+    // out of range or T not the argument's type.
+    template <typename T>
+    T GetValue(const std::string& name, size_t index = 0) const {
+        const ArgumentState* state = FindCustomState(name, &kValueTypeId<T>);
+        std::span<const T> values = state ? CustomValues<T>(*state) : std::span<const T>();
+        return index < values.size() ? values[index] : T();
+    }
+
+    // Converts every value deferred by ArgParser::LazyConversion() and reports the first
+    // one that does not convert as INVALID_VALUE. Afterwards the result is read-only.
+    bool ValidateAll();
+
+private:
+    friend class ArgParser;
+    friend class CommandServer;
+    friend class StreamParser;
+    friend class Snapshot;
+
+    // Values of one argument inside the arena of its type. A run that another argument
+    // has appended behind moves to the end of the arena with twice the room, so appends
+    // stay amortized O(1) and every argument's values stay contiguous.
+    struct ValueSlice {
+        size_t first = 0;
+        size_t count = 0;
+        size_t capacity = 0;
+    };
+
+    // Raw token of a value whose conversion is deferred
+    struct PendingValue {
+        std::string_view text;
+        size_t position = 0;
+    };
+
+    struct ArgumentState {
+        bool touched = false;
+        // values refers to pending_arena_ until the first access converts them
+        bool pending = false;
+        // A deferred value did not convert; the argument reads as empty from then on
+        bool failed = false;
+        bool value_provided = false;
+        bool from_default = false;
+        bool bool_value = false;
+        // Counts streamed values too, which never reach an arena
+        size_t value_count = 0;
+        ValueSlice values;
+        // Token position of the value that did not convert
+        size_t failed_position = 0;
+
+        size_t ValueCount() const {
+            return value_count;
+        }
+
+        void Clear() {
+            *this = ArgumentState();
+        }
+    };
+
+    // AddArgument<T> values are packed per argument into 16-byte cells, which keeps any
+    // T up to kMaxValueAlign aligned; slices count values, not cells.
+    struct alignas(kMaxValueAlign) CustomCell {
+        std::byte bytes[kMaxValueAlign];
+    };
+
+    template <typename T>
+    std::pmr::vector<T>& Arena() {
+        if constexpr (std::is_same_v<T, std::string_view>) {
+            return string_arena_;
+        } else if constexpr (std::is_same_v<T, PendingValue>) {
+            return pending_arena_;
+        } else if constexpr (std::is_same_v<T, int>) {
+            return int_arena_;
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            return int64_arena_;
+        } else if constexpr (std::is_same_v<T, uint64_t>) {
+            return uint64_arena_;
+        } else {
+            return double_arena_;
+        }
+    }
+
+    template <typename T>
+    std::span<const T> Values(const ArgumentState& state) const {
+        const std::pmr::vector<T>& arena = const_cast<ParseResult*>(this)->Arena<T>();
+        return std::span<const T>(arena.data() + state.values.first, state.values.count);
+    }
+
+    // Room for count more values of the argument; they are kept once the caller adds
+    // count to state.values.count.
+    template <typename T>
+    T* Reserve(ArgumentState& state, size_t count) {
+        std::pmr::vector<T>& arena = Arena<T>();
+        ValueSlice& slice = state.values;
+        if (slice.count == 0) {
+            slice.first = arena.size();
+            slice.capacity = 0;
+        }
+        if (slice.count + count > slice.capacity) {
+            if (slice.first + slice.capacity == arena.size()) {
+                slice.capacity = slice.count + count;
+                arena.resize(slice.first + slice.capacity);
+            } else {
+                size_t first = arena.size();
+                size_t capacity = std::max(slice.capacity * 2, slice.count + count);
+                arena.resize(first + capacity);
+                std::copy_n(arena.begin() + slice.first, slice.count, arena.begin() + first);
+                slice.first = first;
+                slice.capacity = capacity;
+            }
+        }
+        return arena.data() + slice.first + slice.count;
+    }
+
+    // Reserve for values of `size` bytes in custom_arena_.
+    std::byte* ReserveCustom(ArgumentState& state, size_t count, size_t size) {
+        auto cells = [size](size_t values) {
+            return (values * size + sizeof(CustomCell) - 1) / sizeof(CustomCell);
+        };
+        ValueSlice& slice = state.values;
+        if (slice.count == 0) {
+            slice.first = custom_arena_.size();
+            slice.capacity = 0;
+        }
+        if (slice.count + count > slice.capacity) {
+            if (slice.first + cells(slice.capacity) == custom_arena_.size()) {
+                slice.capacity = slice.count + count;
+                custom_arena_.resize(slice.first + cells(slice.capacity));
+            } else {
+                size_t first = custom_arena_.size();
+                size_t capacity = std::max(slice.capacity * 2, slice.count + count);
+                custom_arena_.resize(first + cells(capacity));
+                std::copy_n(custom_arena_.begin() + slice.first, cells(slice.count), custom_arena_.begin() + first);
+                slice.first = first;
+                slice.capacity = capacity;
+            }
+        }
+        return custom_arena_[slice.first].bytes + slice.count * size;
+    }
+
+    template <typename T>
+    std::span<const T> CustomValues(const ArgumentState& state) const {
+        if (state.values.count == 0) {
+            return {};
+        }
+        const T* values = reinterpret_cast<const T*>(custom_arena_[state.values.first].bytes);
+        return std::span<const T>(values, state.values.count);
+    }
+
+    template <typename T>
+    void Append(ArgumentState& state, T value) {
+        *Reserve<T>(state, 1) = value;
+        ++state.values.count;
+    }
+
+    // False if state's values did not convert, with failed_position set to the token
+    // position of the offending one. The first read of a type with deferred values
+    // converts all of them in one pass, so the arena of T grows before any span into it
+    // is handed out and never afterwards. Defined for the built-in value types.
+    template <typename T>
+    bool Materialize(const ArgumentState& state, size_t* failed_position = nullptr) const;
+    template <typename T>
+    void ConvertPending();
+
+    // Clears only the states touched by the previous parse; vectors keep their capacity.
+    void Reset(const ArgParser* parser, size_t argument_count);
+    ArgumentState& Touch(size_t index);
+    std::string_view Retain(std::string_view value);
+    template <typename It>
+    std::span<const std::string_view> Input(It begin, It end) {
+        input_.assign(begin, end);
+        return input_;
+    }
+    // Clears the figures and starts the tokenize phase.
+    void BeginStats(size_t argument_count);
+    bool Fail(ParseError error, size_t index, std::string_view argument = {});
+    const ArgumentState* FindState(const std::string& name) const;
+    const ArgumentState* FindCustomState(const std::string& name, const void* type_id) const;
+    const ArgumentState* StateOf(size_t index) const {
+        return index < states_.size() ? &states_[index] : nullptr;
+    }
+    template <typename T>
+    std::span<const T> FindValues(const std::string& name) const;
+    template <typename T>
+    T GetNumericValue(const std::string& name, size_t index) const;
+    size_t ArenaCapacity() const;
+    ParseResult& NestedResult();
+    // Views into other's strings and token vectors, pointed at this result's copies
+    void RebaseViews(const std::vector<const char*>& owned, const std::string_view* input, const std::string_view* expanded);
+
+    const ArgParser* parser_ = nullptr;
+    std::pmr::vector<ArgumentState> states_;
+    std::pmr::vector<size_t> touched_;
+    std::pmr::vector<std::string_view> string_arena_;
+    std::pmr::vector<int> int_arena_;
+    std::pmr::vector<int64_t> int64_arena_;
+    std::pmr::vector<uint64_t> uint64_arena_;
+    std::pmr::vector<double> double_arena_;
+    std::pmr::vector<PendingValue> pending_arena_;
+    // Bit 1 << ArgParser::Argument::Type for every type with deferred values
+    unsigned pending_types_ = 0;
+    std::pmr::vector<CustomCell> custom_arena_;
+    std::pmr::deque<std::pmr::string> owned_values_;
+    size_t owned_count_ = 0;
+    // Response files of the last parse; tokens and string values view into them.
+    std::pmr::vector<MappedFile> mappings_;
+    std::pmr::vector<std::string_view> expanded_;
+    // argv or the caller's strings as views, refilled by every parse
+    std::pmr::vector<std::string_view> input_;
+    // One entry per dispatched token
+    std::pmr::vector<TokenClass> token_classes_;
+    // Selected subcommand and the tokens it parses, starting with its name
+    size_t subcommand_ = npos;
+    size_t subcommand_position_ = 0;
+    std::span<const std::string_view> subcommand_args_;
+    const ParseResult* subcommand_result_ = nullptr;
+    // Reused by ParseInto for subcommand values; Parse uses the sub-parser's own result
+    std::unique_ptr<ParseResult> nested_;
+    bool help_ = false;
+    // Cleared by CommandServer so client lines never open server files; kept across
+    // parses and passed on to subcommand results.
+    bool response_files_ = true;
+    ParseError error_ = ParseError::NONE;
+    size_t error_index_ = npos;
+    std::string_view error_argument_;
+    std::string_view suggestion_;
+#ifdef ARGPARSER_ENABLE_STATS
+    ParseStats stats_;
+    PhaseClock phase_clock_;
+#endif
+};
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Parse instrumentation is compiled in only with ARGPARSER_ENABLE_STATS (CMake option of
+// the same name). Without it every ARGPARSER_STATS(...) site expands to nothing.
+#ifdef ARGPARSER_ENABLE_STATS
+#define ARGPARSER_STATS(...) __VA_ARGS__
+#else
+#define ARGPARSER_STATS(...)
+#endif
+
+namespace ArgumentParser {
+
+struct ParseStats {
+    uint64_t tokens = 0;
+    uint64_t long_lookups = 0;
+    uint64_t long_misses = 0;
+    uint64_t short_lookups = 0;
+    uint64_t short_misses = 0;
+    uint64_t conversions = 0;
+    uint64_t conversion_failures = 0;
+    // Bytes copied into owned strings and StoreValue string targets
+    uint64_t bytes_copied = 0;
+    // Growths of the parser's own containers, each one a heap allocation
+    uint64_t allocations = 0;
+    // Indexed like the arguments, in registration order
+    std::vector<uint64_t> values_per_argument;
+
+    uint64_t tokenize_ns = 0;
+    uint64_t dispatch_ns = 0;
+    uint64_t positional_ns = 0;
+    uint64_t validation_ns = 0;
+};
+
+// Receives the figures of every parse made by a parser it is attached to. Parses through
+// ParseInto/ParseBatch can run concurrently, so OnParse has to be thread-safe then.
+class ParseStatsSink {
+public:
+    virtual ~ParseStatsSink() = default;
+    virtual void OnParse(const ParseStats& stats) = 0;
+};
+
+// Adds the time since the last switch to the phase counter currently running.
+class PhaseClock {
+public:
+    void Switch(uint64_t* phase) {
+        auto now = std::chrono::steady_clock::now();
+        if (phase_) {
+            *phase_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count());
+        }
+        phase_ = phase;
+        start_ = now;
+    }
+
+    void Stop() {
+        Switch(nullptr);
+    }
+
+private:
+    uint64_t* phase_ = nullptr;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}
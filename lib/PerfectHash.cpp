@@ -0,0 +1,100 @@
+#include "PerfectHash.h"
+
+#include <algorithm>
+
+namespace ArgumentParser {
+
+uint64_t PerfectHash::Hash(std::string_view key, uint64_t seed) {
+    uint64_t h = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void PerfectHash::Clear() {
+    displacements_.clear();
+    keys_.clear();
+    indices_.clear();
+}
+
+void PerfectHash::Build(std::span<const std::string_view> keys) {
+    Clear();
+    const size_t size = keys.size();
+    if (size == 0) {
+        return;
+    }
+    displacements_.assign(size, 0);
+    keys_.assign(size, std::string_view());
+    indices_.assign(size, 0);
+
+    std::vector<std::vector<uint32_t>> buckets(size);
+    for (uint32_t i = 0; i < size; ++i) {
+        buckets[Hash(keys[i], 0) % size].push_back(i);
+    }
+    std::vector<uint32_t> order(size);
+    for (uint32_t b = 0; b < size; ++b) {
+        order[b] = b;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    std::vector<bool> taken(size, false);
+    std::vector<size_t> slots;
+    size_t next_free = 0;
+    for (uint32_t b : order) {
+        const std::vector<uint32_t>& bucket = buckets[b];
+        if (bucket.empty()) {
+            break;
+        }
+        if (bucket.size() == 1) {
+            while (taken[next_free]) {
+                ++next_free;
+            }
+            taken[next_free] = true;
+            displacements_[b] = -static_cast<int64_t>(next_free) - 1;
+            keys_[next_free] = keys[bucket[0]];
+            indices_[next_free] = bucket[0];
+            continue;
+        }
+        for (uint64_t seed = 1;; ++seed) {
+            slots.clear();
+            bool placed = true;
+            for (uint32_t key_index : bucket) {
+                size_t slot = Hash(keys[key_index], seed) % size;
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    placed = false;
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (!placed) {
+                continue;
+            }
+            for (size_t k = 0; k < bucket.size(); ++k) {
+                taken[slots[k]] = true;
+                keys_[slots[k]] = keys[bucket[k]];
+                indices_[slots[k]] = bucket[k];
+            }
+            displacements_[b] = static_cast<int64_t>(seed);
+            break;
+        }
+    }
+}
+
+size_t PerfectHash::Find(std::string_view key) const {
+    const size_t size = keys_.size();
+    if (size == 0) {
+        return npos;
+    }
+    int64_t displacement = displacements_[Hash(key, 0) % size];
+    size_t slot = displacement < 0 ? static_cast<size_t>(-displacement - 1) : Hash(key, displacement) % size;
+    return keys_[slot] == key ? indices_[slot] : npos;
+}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ArgumentParser {
+
+// Minimal perfect hash over a fixed set of distinct keys (hash-and-displace).
+// Find returns the position of the key in the span passed to Build, or npos.
+// Keys are not copied: the strings they view must outlive the table.
+class PerfectHash {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    void Build(std::span<const std::string_view> keys);
+    void Clear();
+    size_t Find(std::string_view key) const;
+    size_t Size() const { return keys_.size(); }
+
+private:
+    static uint64_t Hash(std::string_view key, uint64_t seed);
+
+    std::vector<int64_t> displacements_;
+    std::vector<std::string_view> keys_;
+    std::vector<uint32_t> indices_;
+};
+
+}
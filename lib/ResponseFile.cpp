@@ -0,0 +1,111 @@
+#include "ResponseFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace ArgumentParser {
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const char* path, bool read_only) {
+    Close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    if (info.st_size == 0) {
+        ::close(fd);
+        return true;
+    }
+    void* data = read_only
+        ? ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0)
+        : ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    if (!read_only) {
+        ::madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+    }
+    data_ = static_cast<char*>(data);
+    size_ = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_) {
+        ::munmap(data_, size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+namespace {
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+}
+
+bool TokenizeResponse(char* data, size_t size, std::pmr::vector<std::string_view>& tokens) {
+    size_t i = 0;
+    while (i < size) {
+        if (IsSpace(data[i])) {
+            ++i;
+            continue;
+        }
+        // Plain tokens are only scanned; out moves behind i once a quote or escape is dropped.
+        char* begin = data + i;
+        char* out = begin;
+        char quote = '\0';
+        while (i < size && (quote || !IsSpace(data[i]))) {
+            char c = data[i++];
+            if (quote == '\'') {
+                if (c == '\'') {
+                    quote = '\0';
+                    continue;
+                }
+            } else if (c == '\\' && i < size) {
+                c = data[i++];
+            } else if (c == '"' || (c == '\'' && !quote)) {
+                quote = quote ? '\0' : c;
+                continue;
+            }
+            if (out != data + i - 1) {
+                *out = c;
+            }
+            ++out;
+        }
+        if (quote) {
+            return false;
+        }
+        tokens.emplace_back(begin, static_cast<size_t>(out - begin));
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace ArgumentParser {
+
+// View of a whole file through a memory mapping. The default private mapping is
+// copy-on-write, so tokenizing in place only copies the pages where quotes had to be
+// removed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    // path must be null-terminated. An empty file maps to an empty view. A read-only
+    // mapping is shared with every other process mapping the file; Data() must then
+    // not be written.
+    bool Open(const char* path, bool read_only = false);
+    void Close();
+
+    char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+private:
+    char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Splits a response file into tokens in place. Tokens are separated by whitespace;
+// single quotes keep everything literally, double quotes and bare text honour a
+// backslash before any character. Returns false on an unterminated quote.
+bool TokenizeResponse(char* data, size_t size, std::pmr::vector<std::string_view>& tokens);
+
+}
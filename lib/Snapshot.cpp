@@ -0,0 +1,348 @@
+#include "Snapshot.h"
+#include "ArgParser.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace ArgumentParser {
+
+namespace {
+
+bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+constexpr char kMagic[8] = {'A', 'R', 'G', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t kByteOrder = 0x01020304;
+
+void AlignTo8(std::string& image) {
+    image.resize((image.size() + 7) & ~size_t(7));
+}
+
+size_t AppendBytes(std::string& image, const void* data, size_t size) {
+    size_t offset = image.size();
+    image.append(static_cast<const char*>(data), size);
+    return offset;
+}
+
+// Whether [offset, offset + count * element_size) lies within size, without overflow
+bool InBounds(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t size) {
+    if (offset > size) {
+        return false;
+    }
+    return element_size == 0 || count <= (size - offset) / element_size;
+}
+
+}
+
+uint64_t Snapshot::Hash(std::string_view name) {
+    // FNV-1a; part of the format, so it must not change without a version bump
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool Snapshot::Write(const ParseResult& result, const std::string& path) {
+    const ArgParser* parser = result.parser_;
+    if (!parser || !result.Ok() || result.states_.size() != parser->arguments_.size()) {
+        return false;
+    }
+    size_t count = parser->arguments_.size();
+    size_t slot_count = 1;
+    while (slot_count <= count) {
+        slot_count *= 2;
+    }
+
+    std::string image(sizeof(Header) + count * sizeof(Entry) + slot_count * sizeof(uint32_t), '\0');
+    std::vector<Entry> entries(count);
+    // Names go first, so their offsets fit 32 bits however large the values get.
+    for (size_t i = 0; i < count; ++i) {
+        const ArgParser::ArgumentDetails& details = parser->details_[i];
+        entries[i].name_offset = static_cast<uint32_t>(AppendBytes(image, details.name.data(), details.name.size()));
+        entries[i].name_size = static_cast<uint32_t>(details.name.size());
+        if (details.value_type) {
+            std::string_view type_name = details.value_type->name;
+            entries[i].type_name_offset = static_cast<uint32_t>(AppendBytes(image, type_name.data(), type_name.size()));
+            entries[i].type_name_size = static_cast<uint32_t>(type_name.size());
+        }
+    }
+    if (image.size() > UINT32_MAX) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const ArgParser::Argument& arg = parser->arguments_[i];
+        const ParseResult::ArgumentState& state = result.states_[i];
+        Entry& entry = entries[i];
+        entry.type = static_cast<uint8_t>(arg.type);
+        entry.flags = static_cast<uint8_t>((state.value_provided ? kHasValue : 0) | (state.from_default ? kFromDefault : 0)
+                                           | (state.bool_value ? kBoolValue : 0));
+        AlignTo8(image);
+        entry.values_offset = image.size();
+        bool converted = true;
+        auto append_values = [&](auto values) {
+            entry.value_count = static_cast<uint32_t>(values.size());
+            entry.element_size = sizeof(values[0]);
+            AppendBytes(image, values.data(), values.size_bytes());
+        };
+        switch (arg.type) {
+            case ArgParser::Argument::STRING: {
+                std::span<const std::string_view> values = result.Values<std::string_view>(state);
+                entry.value_count = static_cast<uint32_t>(values.size());
+                entry.element_size = sizeof(StringRef);
+                image.resize(image.size() + values.size() * sizeof(StringRef));
+                for (size_t k = 0; k < values.size(); ++k) {
+                    StringRef ref{AppendBytes(image, values[k].data(), values[k].size()), values[k].size()};
+                    std::memcpy(image.data() + entry.values_offset + k * sizeof(StringRef), &ref, sizeof(ref));
+                }
+                break;
+            }
+            case ArgParser::Argument::INT:
+                converted = result.Materialize<int>(state);
+                if (converted) {
+                    append_values(result.Values<int>(state));
+                }
+                break;
+            case ArgParser::Argument::INT64:
+                converted = result.Materialize<int64_t>(state);
+                if (converted) {
+                    append_values(result.Values<int64_t>(state));
+                }
+                break;
+            case ArgParser::Argument::UINT64:
+                converted = result.Materialize<uint64_t>(state);
+                if (converted) {
+                    append_values(result.Values<uint64_t>(state));
+                }
+                break;
+            case ArgParser::Argument::DOUBLE:
+                converted = result.Materialize<double>(state);
+                if (converted) {
+                    append_values(result.Values<double>(state));
+                }
+                break;
+            case ArgParser::Argument::CUSTOM: {
+                size_t size = parser->details_[i].value_type->size;
+                entry.value_count = static_cast<uint32_t>(state.values.count);
+                entry.element_size = static_cast<uint16_t>(size);
+                if (state.values.count > 0) {
+                    AppendBytes(image, result.custom_arena_[state.values.first].bytes, state.values.count * size);
+                }
+                break;
+            }
+            case ArgParser::Argument::FLAG:
+                break;
+        }
+        if (!converted) {
+            return false;
+        }
+    }
+    std::memcpy(image.data() + sizeof(Header), entries.data(), count * sizeof(Entry));
+
+    uint32_t* slots = reinterpret_cast<uint32_t*>(image.data() + sizeof(Header) + count * sizeof(Entry));
+    for (size_t i = 0; i < count; ++i) {
+        const std::string& name = parser->details_[i].name;
+        // A name registered twice resolves to its last argument, as in the parser.
+        if (parser->FindLong(name) != &parser->arguments_[i]) {
+            continue;
+        }
+        size_t slot = Hash(name) & (slot_count - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots[slot] = static_cast<uint32_t>(i + 1);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.size = image.size();
+    header.argument_count = static_cast<uint32_t>(count);
+    header.slot_count = static_cast<uint32_t>(slot_count);
+    header.help = result.Help() ? 1 : 0;
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    // Readers mapping the old file keep it; new ones see the complete image or none. The
+    // temporary name is unique, so concurrent writers to one path do not share it.
+    std::string temporary = path + ".XXXXXX";
+    int fd = ::mkstemp(temporary.data());
+    if (fd < 0) {
+        return false;
+    }
+    bool written = WriteAll(fd, image.data(), image.size()) && ::fsync(fd) == 0;
+    written = ::close(fd) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot::Open(const std::string& path) {
+    Close();
+    if (!file_.Open(path.c_str(), true)) {
+        return false;
+    }
+    data_ = file_.Data();
+    if (!Validate()) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void Snapshot::Close() {
+    file_.Close();
+    data_ = nullptr;
+}
+
+bool Snapshot::Validate() const {
+    size_t size = file_.Size();
+    if (size < sizeof(Header)) {
+        return false;
+    }
+    const Header& header = GetHeader();
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion
+        || header.byte_order != kByteOrder || header.size != size) {
+        return false;
+    }
+    uint64_t slot_count = header.slot_count;
+    if (slot_count == 0 || (slot_count & (slot_count - 1)) != 0 || slot_count <= header.argument_count
+        || !InBounds(sizeof(Header), header.argument_count, sizeof(Entry), size)
+        || !InBounds(sizeof(Header) + uint64_t(header.argument_count) * sizeof(Entry), slot_count, sizeof(uint32_t), size)) {
+        return false;
+    }
+    // Every entry sits in at most one slot and one slot stays free, so probes end.
+    std::vector<bool> placed(header.argument_count + 1);
+    for (uint64_t i = 0; i < slot_count; ++i) {
+        uint32_t index = Slots()[i];
+        if (index > header.argument_count || (index != 0 && placed[index])) {
+            return false;
+        }
+        placed[index] = true;
+    }
+    if (!placed[0]) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header.argument_count; ++i) {
+        const Entry& entry = Entries()[i];
+        if (entry.type > kCustomType || !InBounds(entry.name_offset, entry.name_size, 1, size)
+            || !InBounds(entry.type_name_offset, entry.type_name_size, 1, size)
+            || entry.values_offset % 8 != 0 || !InBounds(entry.values_offset, entry.value_count, entry.element_size, size)) {
+            return false;
+        }
+        size_t expected = 0;
+        switch (entry.type) {
+            case kStringType:
+                expected = sizeof(StringRef);
+                break;
+            case kIntType:
+                expected = sizeof(int);
+                break;
+            case kInt64Type:
+            case kUInt64Type:
+            case kDoubleType:
+                expected = 8;
+                break;
+            case kCustomType:
+                expected = entry.element_size;
+                break;
+        }
+        if (entry.element_size != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const Snapshot::Entry* Snapshot::Find(std::string_view name) const {
+    if (!data_) {
+        return nullptr;
+    }
+    const Header& header = GetHeader();
+    size_t mask = header.slot_count - 1;
+    // Validate() made sure a free slot exists, so the probe ends.
+    for (size_t slot = Hash(name) & mask;; slot = (slot + 1) & mask) {
+        uint32_t index = Slots()[slot];
+        if (index == 0) {
+            return nullptr;
+        }
+        const Entry& entry = Entries()[index - 1];
+        if (Name(entry) == name) {
+            return &entry;
+        }
+    }
+}
+
+bool Snapshot::Help() const {
+    return data_ && GetHeader().help != 0;
+}
+
+bool Snapshot::Contains(std::string_view name) const {
+    return Find(name) != nullptr;
+}
+
+size_t Snapshot::ValueCount(std::string_view name) const {
+    const Entry* entry = Find(name);
+    if (!entry) {
+        return 0;
+    }
+    if (entry->type == kFlagType) {
+        return entry->flags & kHasValue ? 1 : 0;
+    }
+    return entry->value_count;
+}
+
+std::string_view Snapshot::GetStringValue(std::string_view name, size_t index) const {
+    const Entry* entry = Find(name);
+    if (!entry || entry->type != kStringType || index >= entry->value_count) {
+        return {};
+    }
+    StringRef ref;
+    std::memcpy(&ref, data_ + entry->values_offset + index * sizeof(StringRef), sizeof(ref));
+    if (!InBounds(ref.offset, ref.size, 1, file_.Size())) {
+        return {};
+    }
+    return std::string_view(data_ + ref.offset, ref.size);
+}
+
+int Snapshot::GetIntValue(std::string_view name, size_t index) const {
+    return GetNumber<int>(name, index);
+}
+
+int64_t Snapshot::GetInt64Value(std::string_view name, size_t index) const {
+    return GetNumber<int64_t>(name, index);
+}
+
+uint64_t Snapshot::GetUInt64Value(std::string_view name, size_t index) const {
+    return GetNumber<uint64_t>(name, index);
+}
+
+double Snapshot::GetDoubleValue(std::string_view name, size_t index) const {
+    return GetNumber<double>(name, index);
+}
+
+bool Snapshot::GetFlag(std::string_view name) const {
+    const Entry* entry = Find(name);
+    return entry && entry->type == kFlagType && (entry->flags & kBoolValue) != 0;
+}
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "ParseResult.h"
+#include "ResponseFile.h"
+#include "ValueTypes.h"
+
+namespace ArgumentParser {
+
+// Read-only view of a parse written by Snapshot::Write: the schema's argument names and
+// types with every value, in one position-independent image. The image is mapped
+// shared, so any number of processes opening the same file hold a single copy, and the
+// getters read it in place through a hash table stored in the image.
+class Snapshot {
+public:
+    // Bumped whenever the layout changes; Open refuses other versions.
+    static constexpr uint32_t kVersion = 1;
+
+    // Writes the schema and values of result, which may be an ArgParser's Result().
+    // Deferred conversions are done first; false if result holds a failed parse, a
+    // conversion fails or the file can't be written. The image is synced to a uniquely named temporary file with mode 0600,
+    // which then atomically replaces path.
+    static bool Write(const ParseResult& result, const std::string& path);
+
+    // Maps path and checks the header, every table bound and that the slot table
+    // refers to each entry at most once and has a free slot.
+    bool Open(const std::string& path);
+    void Close();
+
+    bool Help() const;
+    bool Contains(std::string_view name) const;
+    // Number of values the argument got, counting a default as one
+    size_t ValueCount(std::string_view name) const;
+
+    // Views into the mapping, valid until Close().
+    std::string_view GetStringValue(std::string_view name, size_t index = 0) const;
+    int GetIntValue(std::string_view name, size_t index = 0) const;
+    int64_t GetInt64Value(std::string_view name, size_t index = 0) const;
+    uint64_t GetUInt64Value(std::string_view name, size_t index = 0) const;
+    double GetDoubleValue(std::string_view name, size_t index = 0) const;
+    bool GetFlag(std::string_view name) const;
+
+    // Values of an int, int64_t, uint64_t or double argument; empty on a type mismatch.
+    template <typename T>
+    std::span<const T> GetAll(std::string_view name) const {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "strings and flags have their own getters");
+        const Entry* entry = Find(name);
+        if (!entry || entry->type != TypeOf<T>()) {
+            return {};
+        }
+        return std::span<const T>(reinterpret_cast<const T*>(data_ + entry->values_offset), entry->value_count);
+    }
+
+    // Value of an AddArgument<T> argument, matched by the traits' name and sizeof(T).
+    // The bytes are those of the writing process, so this is meant for its forks and
+    // for other processes of the same build.
+    template <typename T, typename Traits = ValueTraits<T>>
+    T GetValue(std::string_view name, size_t index = 0) const {
+        const Entry* entry = Find(name);
+        T value{};
+        if (entry && entry->type == kCustomType && entry->element_size == sizeof(T) && index < entry->value_count
+            && TypeName(*entry) == Traits::kName) {
+            std::memcpy(&value, data_ + entry->values_offset + index * sizeof(T), sizeof(T));
+        }
+        return value;
+    }
+
+private:
+    // Image layout, 8-byte aligned, offsets from the start of the image:
+    //   Header, Entry[argument_count], uint32_t slots[slot_count], then values and names.
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        // Written as 0x01020304 by the writer; a reader of the other byte order refuses it
+        uint32_t byte_order;
+        uint64_t size;
+        uint32_t argument_count;
+        uint32_t slot_count;
+        uint8_t help;
+        uint8_t reserved[7];
+    };
+
+    struct Entry {
+        uint32_t name_offset;
+        uint32_t name_size;
+        // Type name of a custom value
+        uint32_t type_name_offset;
+        uint32_t type_name_size;
+        uint64_t values_offset;
+        uint32_t value_count;
+        uint16_t element_size;
+        uint8_t type;
+        // kHasValue, kFromDefault, kBoolValue
+        uint8_t flags;
+    };
+
+    // Strings are stored as (offset, size) pairs in the values area.
+    struct StringRef {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static constexpr uint8_t kHasValue = 1;
+    static constexpr uint8_t kFromDefault = 2;
+    static constexpr uint8_t kBoolValue = 4;
+    // Matches ArgParser's argument types
+    static constexpr uint8_t kStringType = 0;
+    static constexpr uint8_t kIntType = 1;
+    static constexpr uint8_t kFlagType = 2;
+    static constexpr uint8_t kInt64Type = 3;
+    static constexpr uint8_t kUInt64Type = 4;
+    static constexpr uint8_t kDoubleType = 5;
+    static constexpr uint8_t kCustomType = 6;
+
+    template <typename T>
+    static constexpr uint8_t TypeOf() {
+        if constexpr (std::is_same_v<T, int>) {
+            return kIntType;
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            return kInt64Type;
+        } else if constexpr (std::is_same_v<T, uint64_t>) {
+            return kUInt64Type;
+        } else {
+            return kDoubleType;
+        }
+    }
+
+    static uint64_t Hash(std::string_view name);
+
+    const Header& GetHeader() const {
+        return *reinterpret_cast<const Header*>(data_);
+    }
+    const Entry* Entries() const {
+        return reinterpret_cast<const Entry*>(data_ + sizeof(Header));
+    }
+    const uint32_t* Slots() const {
+        return reinterpret_cast<const uint32_t*>(Entries() + GetHeader().argument_count);
+    }
+    std::string_view Name(const Entry& entry) const {
+        return std::string_view(data_ + entry.name_offset, entry.name_size);
+    }
+    std::string_view TypeName(const Entry& entry) const {
+        return std::string_view(data_ + entry.type_name_offset, entry.type_name_size);
+    }
+    const Entry* Find(std::string_view name) const;
+    bool Validate() const;
+    template <typename T>
+    T GetNumber(std::string_view name, size_t index) const {
+        std::span<const T> values = GetAll<T>(name);
+        return index < values.size() ? values[index] : T();
+    }
+
+    MappedFile file_;
+    const char* data_ = nullptr;
+};
+
+}
@@ -0,0 +1,525 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "ValueConverter.h"
+
+// Compile-time counterpart of ArgParser for schemas that are fixed in the source.
+// Names, short names, defaults and the help text are template arguments, so a parser
+// object is just a tuple of values: nothing is allocated and option dispatch goes
+// through lookup tables built by the compiler.
+//
+//     using Parser = ArgumentParser::StaticArgParser<"Program", "Program accumulate arguments",
+//         ArgumentParser::StaticPositional<"N", "values", int64_t, 1>,
+//         ArgumentParser::StaticFlag<"sum", 's', "add args">,
+//         ArgumentParser::StaticRequired<ArgumentParser::StaticIntOption<"count", 'n', "how many">>>;
+//     Parser parser;
+//     parser.Parse(argc, argv);
+//     int count = parser.Get<"count">();
+//     int64_t first = parser.Get<"N">()[0];
+//
+// String values are views into argv. Tokens are read as by ArgParser: `--name=` with
+// nothing after '=' takes the next token, `--` makes every later token positional, and
+// a help flag named "help" skips the required checks. Unlike ArgParser, there is at most
+// one positional argument, its values must be one contiguous run of tokens (options go
+// before or after it, `--` only before it) and it can't be given as `--name=value`.
+// Options given again keep their last value; no option is multi-value.
+
+namespace ArgumentParser {
+
+template <size_t N>
+struct FixedString {
+    char data[N]{};
+
+    constexpr FixedString(const char (&str)[N]) {
+        std::copy_n(str, N, data);
+    }
+
+    constexpr std::string_view View() const {
+        return std::string_view(data, N - 1);
+    }
+};
+
+// Values of a StaticPositional: views of its run of tokens. Each token was checked to
+// convert during Parse and is converted again on access, so no value is stored.
+template <typename T>
+class StaticValues {
+public:
+    using value_type = T;
+
+    constexpr StaticValues() = default;
+    StaticValues(char* const* tokens, size_t count) : c_strings_(tokens), count_(count) {}
+    StaticValues(const std::string_view* tokens, size_t count) : views_(tokens), count_(count) {}
+
+    size_t size() const {
+        return count_;
+    }
+
+    bool empty() const {
+        return count_ == 0;
+    }
+
+    T operator[](size_t index) const {
+        std::string_view token = views_ ? views_[index] : std::string_view(c_strings_[index]);
+        if constexpr (std::is_same_v<T, std::string_view>) {
+            return token;
+        } else {
+            T value{};
+            ConvertValue(token, value);
+            return value;
+        }
+    }
+
+private:
+    char* const* c_strings_ = nullptr;
+    const std::string_view* views_ = nullptr;
+    size_t count_ = 0;
+};
+
+template <FixedString Name, char ShortName = '\0', FixedString Help = "", bool Default = false>
+struct StaticFlag {
+    using value_type = bool;
+    static constexpr std::string_view kName = Name.View();
+    static constexpr char kShortName = ShortName;
+    static constexpr std::string_view kHelp = Help.View();
+    static constexpr std::string_view kTypeName = "";
+    static constexpr bool kDefault = Default;
+    static constexpr bool kHasDefault = Default;
+    static constexpr bool kRequired = false;
+    static constexpr bool kPositional = false;
+    static constexpr size_t kMinCount = 0;
+};
+
+// HasDefault shows a default of 0 in the help text; any other default is always shown.
+template <FixedString Name, char ShortName = '\0', FixedString Help = "", int Default = 0, bool HasDefault = Default != 0>
+struct StaticIntOption {
+    using value_type = int;
+    static constexpr std::string_view kName = Name.View();
+    static constexpr char kShortName = ShortName;
+    static constexpr std::string_view kHelp = Help.View();
+    static constexpr std::string_view kTypeName = "int";
+    static constexpr int kDefault = Default;
+    static constexpr bool kHasDefault = HasDefault;
+    static constexpr bool kRequired = false;
+    static constexpr bool kPositional = false;
+    static constexpr size_t kMinCount = 0;
+};
+
+template <FixedString Name, char ShortName = '\0', FixedString Help = "", FixedString Default = "">
+struct StaticStringOption {
+    using value_type = std::string_view;
+    static constexpr std::string_view kName = Name.View();
+    static constexpr char kShortName = ShortName;
+    static constexpr std::string_view kHelp = Help.View();
+    static constexpr std::string_view kTypeName = "string";
+    static constexpr std::string_view kDefault = Default.View();
+    static constexpr bool kHasDefault = !Default.View().empty();
+    static constexpr bool kRequired = false;
+    static constexpr bool kPositional = false;
+    static constexpr size_t kMinCount = 0;
+};
+
+// Takes every token that is not an option, as ArgParser's MultiValue(MinCount).Positional().
+// T is int, int64_t, uint64_t, double or std::string_view.
+template <FixedString Name, FixedString Help = "", typename T = int64_t, size_t MinCount = 0>
+struct StaticPositional {
+    using value_type = StaticValues<T>;
+    static constexpr std::string_view kName = Name.View();
+    static constexpr char kShortName = '\0';
+    static constexpr std::string_view kHelp = Help.View();
+    static constexpr std::string_view kTypeName = std::is_same_v<T, int> ? "int"
+        : std::is_same_v<T, int64_t> ? "int64" : std::is_same_v<T, uint64_t> ? "uint64"
+        : std::is_same_v<T, double> ? "double" : "string";
+    static constexpr value_type kDefault{};
+    static constexpr bool kHasDefault = false;
+    static constexpr bool kRequired = false;
+    static constexpr bool kPositional = true;
+    static constexpr size_t kMinCount = MinCount;
+};
+
+// Option that Parse fails without, as ArgParser's Required().
+template <typename Option>
+struct StaticRequired : Option {
+    static_assert(!Option::kPositional, "a positional is required through its MinCount");
+    static constexpr bool kRequired = true;
+};
+
+namespace Detail {
+
+constexpr uint64_t StaticHash(std::string_view key) {
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : key) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Writes into out when it is set, otherwise only measures.
+struct HelpWriter {
+    char* out = nullptr;
+    size_t size = 0;
+
+    constexpr void Put(char c) {
+        if (out) {
+            out[size] = c;
+        }
+        ++size;
+    }
+
+    constexpr void Put(std::string_view str) {
+        for (char c : str) {
+            Put(c);
+        }
+    }
+
+    constexpr void Put(const char* str) {
+        Put(std::string_view(str));
+    }
+
+    constexpr void Put(int value) {
+        if (value < 0) {
+            Put('-');
+        }
+        char digits[16]{};
+        size_t count = 0;
+        unsigned magnitude = value < 0 ? 0u - static_cast<unsigned>(value) : static_cast<unsigned>(value);
+        do {
+            digits[count++] = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+        while (count > 0) {
+            Put(digits[--count]);
+        }
+    }
+
+    constexpr void Put(bool value) {
+        Put(value ? std::string_view("true") : std::string_view("false"));
+    }
+};
+
+}
+
+template <FixedString ProgramName, FixedString Description, typename... Options>
+class StaticArgParser {
+public:
+    static constexpr size_t kOptionCount = sizeof...(Options);
+    static constexpr size_t kNotFound = kOptionCount;
+
+    bool Parse(int argc, char** argv) {
+        return ParseTokens(std::span<char* const>(argv, static_cast<size_t>(argc)));
+    }
+
+    bool Parse(std::span<const std::string_view> args) {
+        return ParseTokens(args);
+    }
+
+    template <FixedString Name>
+    const auto& Get() const {
+        constexpr size_t index = IndexOf(Name.View());
+        static_assert(index != kNotFound, "unknown option name");
+        return std::get<index>(values_);
+    }
+
+    bool Help() const {
+        return help_;
+    }
+
+    static constexpr std::string_view HelpDescription() {
+        return std::string_view(kHelpText.data(), kHelpText.size());
+    }
+
+private:
+    using Values = std::tuple<typename Options::value_type...>;
+    using Setter = bool (*)(Values&, std::string_view);
+
+    static constexpr std::array<std::string_view, kOptionCount> kNames = {Options::kName...};
+    static constexpr std::array<bool, kOptionCount> kIsFlag = {std::is_same_v<typename Options::value_type, bool>...};
+    static constexpr std::array<char, kOptionCount> kShortNames = {Options::kShortName...};
+    static constexpr std::array<bool, kOptionCount> kRequired = {Options::kRequired...};
+    static constexpr std::array<size_t, kOptionCount> kMinCounts = {Options::kMinCount...};
+    static constexpr size_t kPositional = [] {
+        constexpr std::array<bool, kOptionCount> positional = {Options::kPositional...};
+        return static_cast<size_t>(std::find(positional.begin(), positional.end(), true) - positional.begin());
+    }();
+    static_assert(((Options::kPositional ? 1 : 0) + ... + 0) <= 1, "at most one positional argument");
+
+    static constexpr bool UniqueNames() {
+        for (size_t i = 0; i < kOptionCount; ++i) {
+            for (size_t j = i + 1; j < kOptionCount; ++j) {
+                if (kNames[i] == kNames[j] || (kShortNames[i] && kShortNames[i] == kShortNames[j])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    // The lookup tables keep one entry per name, so a repeated name would shadow another.
+    static_assert(UniqueNames(), "long and short option names must be unique");
+
+    static constexpr size_t IndexOf(std::string_view name) {
+        for (size_t i = 0; i < kOptionCount; ++i) {
+            if (kNames[i] == name) {
+                return i;
+            }
+        }
+        return kNotFound;
+    }
+
+    // Open addressing over precomputed name hashes, sized to a power of two above 2n.
+    static constexpr size_t kLongTableSize = [] {
+        size_t size = 1;
+        while (size < kOptionCount * 2) {
+            size *= 2;
+        }
+        return size;
+    }();
+
+    static constexpr std::array<size_t, kLongTableSize> kLongTable = [] {
+        std::array<size_t, kLongTableSize> table{};
+        table.fill(kNotFound);
+        for (size_t i = 0; i < kOptionCount; ++i) {
+            size_t slot = Detail::StaticHash(kNames[i]) & (kLongTableSize - 1);
+            while (table[slot] != kNotFound) {
+                slot = (slot + 1) & (kLongTableSize - 1);
+            }
+            table[slot] = i;
+        }
+        return table;
+    }();
+
+    static constexpr std::array<size_t, 256> kShortTable = [] {
+        std::array<size_t, 256> table{};
+        table.fill(kNotFound);
+        for (size_t i = 0; i < kOptionCount; ++i) {
+            if (kShortNames[i]) {
+                table[static_cast<unsigned char>(kShortNames[i])] = i;
+            }
+        }
+        return table;
+    }();
+
+    static size_t FindLong(std::string_view name) {
+        size_t slot = Detail::StaticHash(name) & (kLongTableSize - 1);
+        while (kLongTable[slot] != kNotFound) {
+            if (kNames[kLongTable[slot]] == name) {
+                return kLongTable[slot];
+            }
+            slot = (slot + 1) & (kLongTableSize - 1);
+        }
+        return kNotFound;
+    }
+
+    template <size_t I>
+    static bool SetValue(Values& values, std::string_view value) {
+        using T = std::tuple_element_t<I, Values>;
+        if constexpr (std::is_same_v<T, bool>) {
+            std::get<I>(values) = true;
+            return true;
+        } else if constexpr (I == kPositional) {
+            // Only filled from its run of tokens
+            static_cast<void>(value);
+            return false;
+        } else if constexpr (std::is_same_v<T, int>) {
+            int result = 0;
+            if (ConvertValue(value, result) != ConvertResult::OK) {
+                return false;
+            }
+            std::get<I>(values) = result;
+            return true;
+        } else {
+            std::get<I>(values) = value;
+            return true;
+        }
+    }
+
+    static constexpr std::array<Setter, kOptionCount> kSetters = []<size_t... I>(std::index_sequence<I...>) {
+        return std::array<Setter, kOptionCount>{&SetValue<I>...};
+    }(std::index_sequence_for<Options...>{});
+
+    template <typename Writer>
+    static constexpr void WriteHelp(Writer& writer) {
+        writer.Put(ProgramName.View());
+        writer.Put('\n');
+        if (!Description.View().empty()) {
+            writer.Put(Description.View());
+            writer.Put('\n');
+        }
+        writer.Put('\n');
+        (WriteOptionHelp<Options>(writer), ...);
+    }
+
+    template <typename Option, typename Writer>
+    static constexpr void WriteOptionHelp(Writer& writer) {
+        writer.Put("  ");
+        if (Option::kShortName) {
+            writer.Put('-');
+            writer.Put(Option::kShortName);
+            writer.Put(", ");
+        } else {
+            writer.Put("    ");
+        }
+        writer.Put("--");
+        writer.Put(Option::kName);
+        if (!Option::kTypeName.empty()) {
+            writer.Put("=<");
+            writer.Put(Option::kTypeName);
+            writer.Put('>');
+        }
+        writer.Put(", ");
+        writer.Put(Option::kHelp);
+        if constexpr (Option::kPositional) {
+            writer.Put(" [repeated");
+            if constexpr (Option::kMinCount > 0) {
+                writer.Put(", min args = ");
+                writer.Put(static_cast<int>(Option::kMinCount));
+            }
+            writer.Put(']');
+        }
+        if constexpr (Option::kHasDefault) {
+            writer.Put(" [default = ");
+            writer.Put(Option::kDefault);
+            writer.Put(']');
+        }
+        writer.Put('\n');
+    }
+
+    static constexpr size_t kHelpLength = [] {
+        Detail::HelpWriter writer;
+        WriteHelp(writer);
+        return writer.size;
+    }();
+
+    static constexpr std::array<char, kHelpLength> kHelpText = [] {
+        std::array<char, kHelpLength> text{};
+        Detail::HelpWriter writer{text.data()};
+        WriteHelp(writer);
+        return text;
+    }();
+
+    static constexpr Values kDefaults = Values{typename Options::value_type(Options::kDefault)...};
+
+    bool Apply(size_t index, std::string_view value, std::array<bool, kOptionCount>& seen) {
+        if (index == kNotFound || !kSetters[index](values_, value)) {
+            return false;
+        }
+        seen[index] = true;
+        if (kIsFlag[index] && kNames[index] == "help") {
+            help_ = true;
+        }
+        return true;
+    }
+
+    static bool ConvertsToPositional(std::string_view token) {
+        if constexpr (kPositional == kNotFound) {
+            static_cast<void>(token);
+            return false;
+        } else {
+            using T = typename std::tuple_element_t<kPositional, Values>::value_type;
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                return true;
+            } else {
+                T value{};
+                return ConvertValue(token, value) == ConvertResult::OK;
+            }
+        }
+    }
+
+    template <typename Tokens>
+    bool ParseTokens(const Tokens& args) {
+        values_ = kDefaults;
+        help_ = false;
+        std::array<bool, kOptionCount> seen{};
+        size_t run_first = 0;
+        size_t run_count = 0;
+        bool options_done = false;
+        for (size_t i = 1; i < args.size(); ++i) {
+            std::string_view arg = args[i];
+            if (options_done || arg.empty() || arg[0] != '-') {
+                if ((run_count > 0 && run_first + run_count != i) || !ConvertsToPositional(arg)) {
+                    return false;
+                }
+                run_first = run_count == 0 ? i : run_first;
+                ++run_count;
+                continue;
+            }
+            if (arg.size() < 2) {
+                return false;
+            }
+            if (arg[1] == '-') {
+                if (arg.size() == 2) {
+                    options_done = true;
+                    continue;
+                }
+                size_t eq_pos = arg.find('=');
+                std::string_view name = arg.substr(2, eq_pos == std::string_view::npos ? std::string_view::npos : eq_pos - 2);
+                std::string_view value = eq_pos == std::string_view::npos ? std::string_view() : arg.substr(eq_pos + 1);
+                size_t index = FindLong(name);
+                if (index == kNotFound) {
+                    return false;
+                }
+                if (kIsFlag[index]) {
+                    if (!value.empty()) {
+                        return false;
+                    }
+                } else if (value.empty()) {
+                    if (i + 1 >= args.size()) {
+                        return false;
+                    }
+                    value = args[++i];
+                }
+                if (!Apply(index, value, seen)) {
+                    return false;
+                }
+                continue;
+            }
+            for (size_t j = 1; j < arg.size(); ++j) {
+                size_t index = kShortTable[static_cast<unsigned char>(arg[j])];
+                if (index == kNotFound) {
+                    return false;
+                }
+                if (kIsFlag[index]) {
+                    Apply(index, std::string_view(), seen);
+                    continue;
+                }
+                std::string_view value;
+                if (j + 1 < arg.size()) {
+                    value = arg.substr(arg[j + 1] == '=' ? j + 2 : j + 1);
+                } else if (i + 1 < args.size()) {
+                    value = args[++i];
+                } else {
+                    return false;
+                }
+                if (!Apply(index, value, seen)) {
+                    return false;
+                }
+                break;
+            }
+        }
+        if constexpr (kPositional != kNotFound) {
+            std::get<kPositional>(values_) = std::tuple_element_t<kPositional, Values>(args.data() + run_first, run_count);
+            seen[kPositional] = run_count > 0;
+        }
+        if (help_) {
+            return true;
+        }
+        for (size_t i = 0; i < kOptionCount; ++i) {
+            if ((kRequired[i] && !seen[i]) || (i == kPositional && run_count < kMinCounts[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Values values_ = kDefaults;
+    bool help_ = false;
+};
+
+}
@@ -0,0 +1,183 @@
+#include "StreamParser.h"
+
+namespace ArgumentParser {
+
+StreamParser::StreamParser(const ArgParser& parser) : parser_(parser) {}
+
+StreamParser::StreamParser(const ArgParser& parser, std::pmr::memory_resource* resource)
+    : parser_(parser), result_(resource) {}
+
+void StreamParser::OnEvent(EventCallback callback) {
+    on_event_ = std::move(callback);
+}
+
+const ParseResult& StreamParser::Result() const {
+    return result_;
+}
+
+void StreamParser::Restart() {
+    ARGPARSER_STATS(result_.BeginStats(parser_.arguments_.size());)
+    result_.Reset(&parser_, parser_.arguments_.size());
+    index_ = 0;
+    positional_index_ = 0;
+    pending_ = nullptr;
+    pending_index_ = 0;
+    separated_ = false;
+    failed_ = false;
+    finished_ = false;
+}
+
+bool StreamParser::Fail(ParseError error, size_t index, std::string_view argument) {
+    failed_ = true;
+    result_.Fail(error, index, argument);
+    if (on_event_) {
+        on_event_(ParseEvent{ParseEvent::ERROR, index, argument, {}, error});
+    }
+    return false;
+}
+
+void StreamParser::SetFlag(const ArgParser::Argument& arg, size_t index) {
+    ParseResult::ArgumentState& state = result_.Touch(arg.index);
+    state.bool_value = true;
+    state.value_provided = true;
+    if (arg.is_help) {
+        result_.help_ = true;
+    }
+    if (on_event_) {
+        on_event_(ParseEvent{ParseEvent::OPTION, index, parser_.DetailsOf(arg).name, {}, ParseError::NONE});
+    }
+}
+
+bool StreamParser::AppendValue(const ArgParser::Argument& arg, std::string_view value, size_t index) {
+    std::string_view name = parser_.DetailsOf(arg).name;
+    if (!parser_.AppendValue(result_, arg, value, index, false)) {
+        return Fail(ParseError::INVALID_VALUE, index, name);
+    }
+    if (on_event_) {
+        on_event_(ParseEvent{ParseEvent::VALUE, index, name, value, ParseError::NONE});
+    }
+    return true;
+}
+
+bool StreamParser::FeedPositional(std::string_view token, size_t index) {
+    const std::vector<uint32_t>& positional_args = parser_.positional_args_;
+    if (positional_index_ >= positional_args.size()) {
+        return Fail(ParseError::UNEXPECTED_POSITIONAL, index);
+    }
+    const ArgParser::Argument& arg = parser_.arguments_[positional_args[positional_index_]];
+    if (!AppendValue(arg, token, index)) {
+        return false;
+    }
+    // Same hand-over as Parse: before `--` a multi-value positional that is not the
+    // last one yields once it has its minimum count.
+    if (!arg.is_multi_value) {
+        ++positional_index_;
+    } else if (!separated_ && positional_index_ != positional_args.size() - 1
+               && result_.states_[arg.index].ValueCount() >= arg.min_count) {
+        ++positional_index_;
+    }
+    return true;
+}
+
+bool StreamParser::Feed(std::string_view token) {
+    if (finished_) {
+        Restart();
+    }
+    if (failed_) {
+        return false;
+    }
+    size_t index = index_++;
+    ARGPARSER_STATS(++result_.stats_.tokens;)
+    if (index == 0) {
+        return true;
+    }
+    if (pending_) {
+        const ArgParser::Argument* arg_ptr = pending_;
+        pending_ = nullptr;
+        return AppendValue(*arg_ptr, token, index);
+    }
+    if (separated_) {
+        return FeedPositional(token, index);
+    }
+
+    TokenClass token_class = ClassifyToken(token);
+    switch (token_class.kind) {
+        case TokenClass::POSITIONAL:
+            return FeedPositional(token, index);
+        case TokenClass::DASH:
+            return Fail(ParseError::UNKNOWN_OPTION, index);
+        case TokenClass::TERMINATOR:
+            separated_ = true;
+            return true;
+        case TokenClass::LONG_OPTION: {
+            bool has_value = token_class.equals != TokenClass::kNoEquals;
+            std::string_view name = token.substr(2, has_value ? token_class.equals - 2 : std::string_view::npos);
+            std::string_view value = has_value ? token.substr(token_class.equals + 1) : std::string_view();
+            ParseError error = ParseError::NONE;
+            std::string_view suggestion;
+            const ArgParser::Argument* arg_ptr = parser_.MatchLong(name, error, suggestion);
+            if (!arg_ptr) {
+                result_.suggestion_ = suggestion;
+                return Fail(error, index, result_.Retain(name));
+            }
+            if (arg_ptr->type == ArgParser::Argument::FLAG) {
+                if (!value.empty()) {
+                    return Fail(ParseError::UNEXPECTED_VALUE, index, parser_.DetailsOf(*arg_ptr).name);
+                }
+                SetFlag(*arg_ptr, index);
+                return true;
+            }
+            if (value.empty()) {
+                pending_ = arg_ptr;
+                pending_index_ = index;
+                return true;
+            }
+            return AppendValue(*arg_ptr, value, index);
+        }
+        case TokenClass::SHORT_CLUSTER:
+            for (size_t j = 1; j < token.size(); ++j) {
+                const ArgParser::Argument* arg_ptr = parser_.FindShort(token[j]);
+                if (!arg_ptr) {
+                    return Fail(ParseError::UNKNOWN_OPTION, index);
+                }
+                if (arg_ptr->type == ArgParser::Argument::FLAG) {
+                    SetFlag(*arg_ptr, index);
+                    continue;
+                }
+                if (j + 1 == token.size()) {
+                    pending_ = arg_ptr;
+                    pending_index_ = index;
+                    return true;
+                }
+                size_t value_start = token[j + 1] == '=' ? j + 2 : j + 1;
+                return AppendValue(*arg_ptr, token.substr(value_start), index);
+            }
+            return true;
+    }
+    return true;
+}
+
+bool StreamParser::Finish() {
+    if (finished_) {
+        Restart();
+    }
+    finished_ = true;
+    if (failed_) {
+        return false;
+    }
+    if (pending_) {
+        return Fail(ParseError::MISSING_VALUE, pending_index_, parser_.DetailsOf(*pending_).name);
+    }
+    ARGPARSER_STATS(result_.phase_clock_.Switch(&result_.stats_.validation_ns);)
+    bool valid = parser_.Validate(result_);
+    ARGPARSER_STATS(result_.phase_clock_.Stop();)
+    if (!valid) {
+        failed_ = true;
+        if (on_event_) {
+            on_event_(ParseEvent{ParseEvent::ERROR, result_.ErrorIndex(), result_.ErrorArgument(), {}, result_.Error()});
+        }
+    }
+    return valid;
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#include "ArgParser.h"
+#include "ParseResult.h"
+
+namespace ArgumentParser {
+
+// What a fed token did to the result.
+struct ParseEvent {
+    enum Kind : uint8_t { OPTION, VALUE, ERROR };
+
+    Kind kind = OPTION;
+    // Position of the token in the command line
+    size_t index = 0;
+    // Long name of the argument, empty for errors without one
+    std::string_view argument;
+    // The appended value; valid during the callback only
+    std::string_view value;
+    ParseError error = ParseError::NONE;
+};
+
+// Parses a command line that arrives one token at a time against an ArgParser schema,
+// with the same rules and error indices as ParseInto. Between feeds it keeps an option
+// still waiting for its value, the positional reached and whether `--` was seen, so
+// values and OnValue callbacks are available as soon as their token is fed. The first
+// token is the program name, as in argv. Tokens are copied where a value is kept.
+// Response files and subcommands are not expanded.
+class StreamParser {
+public:
+    using EventCallback = std::function<void(const ParseEvent&)>;
+
+    // The parser must outlive this object and not be changed while it is in use.
+    explicit StreamParser(const ArgParser& parser);
+    StreamParser(const ArgParser& parser, std::pmr::memory_resource* resource);
+
+    // Called for every flag set, value appended and error.
+    void OnEvent(EventCallback callback);
+
+    // False once the line has failed; later tokens are ignored until Finish().
+    bool Feed(std::string_view token);
+    // Applies defaults and checks required arguments. The result stays readable until
+    // the next Feed, which starts a new command line.
+    bool Finish();
+
+    const ParseResult& Result() const;
+
+private:
+    void Restart();
+    bool Fail(ParseError error, size_t index, std::string_view argument = {});
+    void SetFlag(const ArgParser::Argument& arg, size_t index);
+    bool AppendValue(const ArgParser::Argument& arg, std::string_view value, size_t index);
+    bool FeedPositional(std::string_view token, size_t index);
+
+    const ArgParser& parser_;
+    ParseResult result_;
+    EventCallback on_event_;
+    size_t index_ = 0;
+    size_t positional_index_ = 0;
+    // Option whose value is the next token, and where that option was
+    const ArgParser::Argument* pending_ = nullptr;
+    size_t pending_index_ = 0;
+    bool separated_ = false;
+    bool failed_ = false;
+    bool finished_ = true;
+};
+
+}
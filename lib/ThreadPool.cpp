@@ -0,0 +1,169 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace ArgumentParser {
+
+namespace {
+
+thread_local const ThreadPool* current_pool = nullptr;
+
+uint64_t PackRange(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+}
+
+uint32_t RangeBegin(uint64_t range) {
+    return static_cast<uint32_t>(range >> 32);
+}
+
+uint32_t RangeEnd(uint64_t range) {
+    return static_cast<uint32_t>(range);
+}
+
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    participants_ = threads;
+    shares_ = std::make_unique<Share[]>(participants_);
+    workers_.reserve(participants_ - 1);
+    for (size_t i = 1; i < participants_; ++i) {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::Size() const {
+    return participants_;
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (count + grain - 1) / grain;
+    if (participants_ == 1 || chunks == 1 || current_pool) {
+        for (size_t begin = 0; begin < count; begin += grain) {
+            body(begin, std::min(count, begin + grain));
+        }
+        return;
+    }
+    // Keep the chunk index within the 32-bit halves of a share.
+    if (chunks > UINT32_MAX) {
+        grain = (count + UINT32_MAX - 1) / UINT32_MAX;
+        chunks = (count + grain - 1) / grain;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+    for (size_t p = 0; p < participants_; ++p) {
+        uint32_t begin = static_cast<uint32_t>(chunks * p / participants_);
+        uint32_t end = static_cast<uint32_t>(chunks * (p + 1) / participants_);
+        shares_[p].range.store(PackRange(begin, end), std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        body_ = &body;
+        count_ = count;
+        grain_ = grain;
+        active_ = participants_ - 1;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    current_pool = this;
+    RunChunks(0);
+    current_pool = nullptr;
+
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    done_.wait(lock, [this] { return active_ == 0; });
+    body_ = nullptr;
+}
+
+void ThreadPool::WorkerLoop(size_t participant) {
+    uint64_t seen = 0;
+    current_pool = this;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+        }
+        RunChunks(participant);
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            --active_;
+        }
+        done_.notify_one();
+    }
+}
+
+void ThreadPool::RunChunks(size_t participant) {
+    uint32_t chunk = 0;
+    do {
+        while (PopOwn(participant, chunk)) {
+            size_t begin = static_cast<size_t>(chunk) * grain_;
+            (*body_)(begin, std::min(count_, begin + grain_));
+        }
+    } while (Steal(participant));
+}
+
+bool ThreadPool::PopOwn(size_t participant, uint32_t& chunk) {
+    std::atomic<uint64_t>& range = shares_[participant].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (RangeBegin(current) < RangeEnd(current)) {
+        if (range.compare_exchange_weak(current, PackRange(RangeBegin(current) + 1, RangeEnd(current)),
+                                        std::memory_order_acq_rel)) {
+            chunk = RangeBegin(current);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::Steal(size_t participant) {
+    while (true) {
+        size_t victim = participants_;
+        uint32_t largest = 0;
+        for (size_t p = 0; p < participants_; ++p) {
+            uint64_t range = shares_[p].range.load(std::memory_order_acquire);
+            uint32_t left = RangeEnd(range) - std::min(RangeBegin(range), RangeEnd(range));
+            if (p != participant && left > largest) {
+                largest = left;
+                victim = p;
+            }
+        }
+        if (victim == participants_) {
+            return false;
+        }
+        std::atomic<uint64_t>& range = shares_[victim].range;
+        uint64_t current = range.load(std::memory_order_acquire);
+        uint32_t begin = RangeBegin(current);
+        uint32_t end = RangeEnd(current);
+        if (begin >= end) {
+            continue;
+        }
+        uint32_t middle = end - (end - begin + 1) / 2;
+        if (range.compare_exchange_strong(current, PackRange(begin, middle), std::memory_order_acq_rel)) {
+            shares_[participant].range.store(PackRange(middle, end), std::memory_order_release);
+            return true;
+        }
+    }
+}
+
+}
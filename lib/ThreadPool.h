@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ArgumentParser {
+
+// Fixed set of worker threads running one ParallelFor at a time. Every participant starts
+// with its own share of the chunks and steals half of the largest remaining share once it
+// runs dry, so uneven chunks do not leave threads idle.
+class ThreadPool {
+public:
+    // 0 means std::thread::hardware_concurrency(); the calling thread always takes part,
+    // so a pool of size 1 runs everything inline.
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t Size() const;
+
+    // Calls body(begin, end) for consecutive ranges covering [0, count), each at most
+    // grain long, and returns when all of them are done. Calls made from inside the body
+    // of any pool run inline on the current thread.
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+private:
+    struct alignas(64) Share {
+        // begin in the high half, end in the low half, both counted in chunks
+        std::atomic<uint64_t> range{0};
+    };
+
+    void WorkerLoop(size_t participant);
+    void RunChunks(size_t participant);
+    bool PopOwn(size_t participant, uint32_t& chunk);
+    bool Steal(size_t participant);
+
+    std::vector<std::thread> workers_;
+    std::unique_ptr<Share[]> shares_;
+    size_t participants_ = 1;
+
+    std::mutex submit_mutex_;
+    std::mutex state_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    uint64_t generation_ = 0;
+    size_t active_ = 0;
+    bool stopping_ = false;
+
+    const std::function<void(size_t, size_t)>* body_ = nullptr;
+    size_t count_ = 0;
+    size_t grain_ = 1;
+};
+
+}
@@ -0,0 +1,82 @@
+#include "TokenClassifier.h"
+
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ARGPARSER_SSE2
+#endif
+
+namespace ArgumentParser {
+
+namespace {
+
+#ifdef ARGPARSER_SSE2
+
+// Bit i is set where byte i of the block is '='.
+uint32_t EqualsMask(__m128i bytes) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('='))));
+}
+
+uint32_t FindEquals(const char* data, size_t size) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint32_t mask = EqualsMask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        if (mask) {
+            return static_cast<uint32_t>(i + std::countr_zero(mask));
+        }
+    }
+    if (i < size) {
+        // Reading past the token could cross into an unmapped page; the tail is copied.
+        alignas(16) char block[16] = {};
+        size_t tail = size - i;
+        std::memcpy(block, data + i, tail);
+        uint32_t mask = EqualsMask(_mm_load_si128(reinterpret_cast<const __m128i*>(block))) & ((1u << tail) - 1);
+        if (mask) {
+            return static_cast<uint32_t>(i + std::countr_zero(mask));
+        }
+    }
+    return TokenClass::kNoEquals;
+}
+
+#else
+
+uint32_t FindEquals(const char* data, size_t size) {
+    const void* found = std::memchr(data, '=', size);
+    return found ? static_cast<uint32_t>(static_cast<const char*>(found) - data) : TokenClass::kNoEquals;
+}
+
+#endif
+
+}
+
+TokenClass ClassifyToken(std::string_view token) {
+    TokenClass token_class;
+    if (token.empty()) {
+        return token_class;
+    }
+    if (token[0] != '-') {
+        token_class.kind = TokenClass::POSITIONAL;
+    } else if (token.size() == 1) {
+        token_class.kind = TokenClass::DASH;
+    } else if (token[1] != '-') {
+        token_class.kind = TokenClass::SHORT_CLUSTER;
+    } else if (token.size() == 2) {
+        token_class.kind = TokenClass::TERMINATOR;
+    } else {
+        // Only long options split at '=', so other tokens are never scanned.
+        token_class.kind = TokenClass::LONG_OPTION;
+        token_class.equals = FindEquals(token.data(), token.size());
+    }
+    return token_class;
+}
+
+void ClassifyTokens(std::span<const std::string_view> tokens, std::pmr::vector<TokenClass>& classes) {
+    classes.resize(tokens.size());
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        classes[i] = ClassifyToken(tokens[i]);
+    }
+}
+
+}
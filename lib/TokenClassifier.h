@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ArgumentParser {
+
+// Shape of one command-line token, worked out for the whole line before dispatch so
+// that the dispatch loop branches on one packed byte instead of rescanning the text.
+struct TokenClass {
+    static constexpr uint32_t kNoEquals = UINT32_MAX;
+
+    enum Kind : uint8_t { POSITIONAL, LONG_OPTION, SHORT_CLUSTER, TERMINATOR, DASH };
+
+    // Offset of the first '=' in a long option, kNoEquals if there is none or the
+    // token is of another kind
+    uint32_t equals = kNoEquals;
+    Kind kind = POSITIONAL;
+};
+
+TokenClass ClassifyToken(std::string_view token);
+// Replaces classes with one entry per token. The '=' scan of long options uses SSE2
+// where the target has it and memchr elsewhere.
+void ClassifyTokens(std::span<const std::string_view> tokens, std::pmr::vector<TokenClass>& classes);
+
+}
@@ -0,0 +1,51 @@
+#include "ValueConverter.h"
+
+#include <charconv>
+#include <system_error>
+
+namespace ArgumentParser {
+
+namespace {
+
+template <typename T>
+ConvertResult FromChars(std::string_view text, T& value) {
+    if (!text.empty() && text[0] == '+') {
+        text.remove_prefix(1);
+        if (!text.empty() && text[0] == '-') {
+            return ConvertResult::INVALID;
+        }
+    }
+    if (text.empty()) {
+        return ConvertResult::INVALID;
+    }
+    T result{};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), result);
+    if (ec == std::errc::result_out_of_range) {
+        return ConvertResult::OUT_OF_RANGE;
+    }
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return ConvertResult::INVALID;
+    }
+    value = result;
+    return ConvertResult::OK;
+}
+
+}
+
+ConvertResult ConvertValue(std::string_view text, int& value) {
+    return FromChars(text, value);
+}
+
+ConvertResult ConvertValue(std::string_view text, int64_t& value) {
+    return FromChars(text, value);
+}
+
+ConvertResult ConvertValue(std::string_view text, uint64_t& value) {
+    return FromChars(text, value);
+}
+
+ConvertResult ConvertValue(std::string_view text, double& value) {
+    return FromChars(text, value);
+}
+
+}
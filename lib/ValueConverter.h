@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace ArgumentParser {
+
+// Allocation-free numeric conversion on top of std::from_chars. The whole text has to be
+// consumed; a leading '+' is accepted for every numeric type.
+enum class ConvertResult { OK, INVALID, OUT_OF_RANGE };
+
+ConvertResult ConvertValue(std::string_view text, int& value);
+ConvertResult ConvertValue(std::string_view text, int64_t& value);
+ConvertResult ConvertValue(std::string_view text, uint64_t& value);
+ConvertResult ConvertValue(std::string_view text, double& value);
+
+}
@@ -0,0 +1,176 @@
+#include "ValueTypes.h"
+
+#include <arpa/inet.h>
+
+#include <charconv>
+
+namespace ArgumentParser {
+
+namespace {
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Splits a leading `digits[.digits]` off text.
+bool TakeNumber(std::string_view& text, uint64_t& whole, std::string_view& fraction) {
+    size_t end = 0;
+    while (end < text.size() && IsDigit(text[end])) {
+        ++end;
+    }
+    whole = 0;
+    if (end > 0) {
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + end, whole);
+        if (ec != std::errc()) {
+            return false;
+        }
+    }
+    fraction = {};
+    if (end < text.size() && text[end] == '.') {
+        size_t start = end + 1;
+        size_t fraction_end = start;
+        while (fraction_end < text.size() && IsDigit(text[fraction_end])) {
+            ++fraction_end;
+        }
+        fraction = text.substr(start, fraction_end - start);
+        if (end == 0 && fraction.empty()) {
+            return false;
+        }
+        end = fraction_end;
+    }
+    if (end == 0) {
+        return false;
+    }
+    text.remove_prefix(end);
+    return true;
+}
+
+// whole.fraction * scale, truncated; false if it does not fit below limit. The fraction
+// is scaled as one division, digits * scale / 10^count, so units that are not powers of
+// ten stay exact; digits past the 19th are below one unit and dropped.
+bool Scale(uint64_t whole, std::string_view fraction, uint64_t scale, uint64_t limit, uint64_t& result) {
+    unsigned __int128 digits = 0;
+    unsigned __int128 denominator = 1;
+    for (char digit : fraction.substr(0, 19)) {
+        digits = digits * 10 + static_cast<unsigned>(digit - '0');
+        denominator *= 10;
+    }
+    unsigned __int128 total = static_cast<unsigned __int128>(whole) * scale + digits * scale / denominator;
+    if (total > limit) {
+        return false;
+    }
+    result = static_cast<uint64_t>(total);
+    return true;
+}
+
+template <size_t N>
+uint64_t FindUnit(const std::pair<std::string_view, uint64_t> (&units)[N], std::string_view unit) {
+    for (const auto& [name, scale] : units) {
+        if (name == unit) {
+            return scale;
+        }
+    }
+    return 0;
+}
+
+constexpr std::pair<std::string_view, uint64_t> kDurationUnits[] = {
+    {"ns", 1},
+    {"us", 1'000},
+    {"ms", 1'000'000},
+    {"s", 1'000'000'000},
+    {"m", 60'000'000'000},
+    {"h", 3'600'000'000'000},
+    {"d", 86'400'000'000'000},
+};
+
+constexpr uint64_t kKilo = 1000;
+constexpr uint64_t kKibi = 1024;
+
+constexpr std::pair<std::string_view, uint64_t> kSizeUnits[] = {
+    {"", 1}, {"B", 1},
+    {"k", kKilo}, {"K", kKilo}, {"kB", kKilo}, {"KB", kKilo},
+    {"M", kKilo * kKilo}, {"MB", kKilo * kKilo},
+    {"G", kKilo * kKilo * kKilo}, {"GB", kKilo * kKilo * kKilo},
+    {"T", kKilo * kKilo * kKilo * kKilo}, {"TB", kKilo * kKilo * kKilo * kKilo},
+    {"P", kKilo * kKilo * kKilo * kKilo * kKilo}, {"PB", kKilo * kKilo * kKilo * kKilo * kKilo},
+    {"Ki", kKibi}, {"KiB", kKibi},
+    {"Mi", kKibi * kKibi}, {"MiB", kKibi * kKibi},
+    {"Gi", kKibi * kKibi * kKibi}, {"GiB", kKibi * kKibi * kKibi},
+    {"Ti", kKibi * kKibi * kKibi * kKibi}, {"TiB", kKibi * kKibi * kKibi * kKibi},
+    {"Pi", kKibi * kKibi * kKibi * kKibi * kKibi}, {"PiB", kKibi * kKibi * kKibi * kKibi * kKibi},
+};
+
+}
+
+bool ParseDuration(std::string_view text, std::chrono::nanoseconds& value) {
+    if (text.empty()) {
+        return false;
+    }
+    constexpr uint64_t kLimit = static_cast<uint64_t>(INT64_MAX);
+    uint64_t total = 0;
+    while (!text.empty()) {
+        uint64_t whole;
+        std::string_view fraction;
+        if (!TakeNumber(text, whole, fraction)) {
+            return false;
+        }
+        size_t unit_end = 0;
+        while (unit_end < text.size() && !IsDigit(text[unit_end]) && text[unit_end] != '.') {
+            ++unit_end;
+        }
+        uint64_t scale = FindUnit(kDurationUnits, text.substr(0, unit_end));
+        text.remove_prefix(unit_end);
+        uint64_t part;
+        if (scale == 0 || !Scale(whole, fraction, scale, kLimit - total, part)) {
+            return false;
+        }
+        total += part;
+    }
+    value = std::chrono::nanoseconds(static_cast<int64_t>(total));
+    return true;
+}
+
+bool ParseByteSize(std::string_view text, ByteSize& value) {
+    uint64_t whole;
+    std::string_view fraction;
+    if (!TakeNumber(text, whole, fraction)) {
+        return false;
+    }
+    uint64_t scale = FindUnit(kSizeUnits, text);
+    return scale != 0 && Scale(whole, fraction, scale, UINT64_MAX, value.bytes);
+}
+
+bool ParseEndpoint(std::string_view text, Endpoint& value) {
+    size_t colon = text.rfind(':');
+    if (colon == std::string_view::npos || colon + 1 == text.size()) {
+        return false;
+    }
+    std::string_view host = text.substr(0, colon);
+    std::string_view port = text.substr(colon + 1);
+    bool ipv6 = host.size() >= 2 && host.front() == '[' && host.back() == ']';
+    if (ipv6) {
+        host = host.substr(1, host.size() - 2);
+    }
+    // inet_pton wants a terminated string; the longest IPv6 form is 45 characters.
+    char buffer[64];
+    if (host.empty() || host.size() >= sizeof(buffer)) {
+        return false;
+    }
+    std::memcpy(buffer, host.data(), host.size());
+    buffer[host.size()] = '\0';
+    Endpoint endpoint;
+    if (inet_pton(ipv6 ? AF_INET6 : AF_INET, buffer, endpoint.address.data()) != 1) {
+        return false;
+    }
+    uint64_t port_value = 0;
+    auto [ptr, ec] = std::from_chars(port.data(), port.data() + port.size(), port_value);
+    if (ec != std::errc() || ptr != port.data() + port.size() || port_value > UINT16_MAX) {
+        return false;
+    }
+    endpoint.port = static_cast<uint16_t>(port_value);
+    endpoint.ipv6 = ipv6;
+    value = endpoint;
+    return true;
+}
+
+}
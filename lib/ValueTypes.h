@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace ArgumentParser {
+
+// Conversion of a value type registered through ArgParser::AddArgument<T>. A
+// specialization provides
+//     static constexpr std::string_view kName;   // shown in the help text
+//     static bool Parse(std::string_view text, T& value);
+// T has to be trivially copyable and at most kMaxValueSize bytes: values are packed into
+// the result's arena without running constructors.
+template <typename T>
+struct ValueTraits;
+
+inline constexpr size_t kMaxValueSize = 64;
+inline constexpr size_t kMaxValueAlign = 16;
+
+template <typename T>
+inline constexpr bool kBuiltinValue = std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>
+    || std::is_same_v<T, bool> || std::is_same_v<T, int> || std::is_same_v<T, int64_t>
+    || std::is_same_v<T, uint64_t> || std::is_same_v<T, double>;
+
+// One entry per (T, Traits) pair, resolved at compile time; arguments of that type
+// point to it and every parse converts through its function pointer.
+struct ValueType {
+    // Shared by all traits of one T, so a handle of T can check it
+    const void* id;
+    std::string_view name;
+    size_t size;
+    bool (*convert)(std::string_view text, void* value);
+};
+
+template <typename T>
+inline constexpr char kValueTypeId = 0;
+
+template <typename T, typename Traits>
+bool ConvertErased(std::string_view text, void* value) {
+    T parsed{};
+    if (!Traits::Parse(text, parsed)) {
+        return false;
+    }
+    std::memcpy(value, &parsed, sizeof(T));
+    return true;
+}
+
+template <typename T, typename Traits>
+inline constexpr ValueType kValueType{&kValueTypeId<T>, Traits::kName, sizeof(T), &ConvertErased<T, Traits>};
+
+// Built-in value types
+
+// Sequence of <number><unit> pairs with units ns, us, ms, s, m, h and d, e.g. `250ms`,
+// `1.5s` or `1h30m`.
+bool ParseDuration(std::string_view text, std::chrono::nanoseconds& value);
+
+template <>
+struct ValueTraits<std::chrono::nanoseconds> {
+    static constexpr std::string_view kName = "duration";
+    static bool Parse(std::string_view text, std::chrono::nanoseconds& value) {
+        return ParseDuration(text, value);
+    }
+};
+
+// <number>[unit] with decimal (k, KB, M, MB, ...) or binary (Ki, KiB, Mi, MiB, ...)
+// units up to peta, e.g. `64MiB` or `1.5G`; a bare number or B means bytes.
+struct ByteSize {
+    uint64_t bytes = 0;
+};
+
+bool ParseByteSize(std::string_view text, ByteSize& value);
+
+template <>
+struct ValueTraits<ByteSize> {
+    static constexpr std::string_view kName = "size";
+    static bool Parse(std::string_view text, ByteSize& value) {
+        return ParseByteSize(text, value);
+    }
+};
+
+// Numeric address and port, `10.0.0.1:8080` or `[::1]:8080`.
+struct Endpoint {
+    // Network byte order; an IPv4 address fills the first four bytes
+    std::array<uint8_t, 16> address{};
+    uint16_t port = 0;
+    bool ipv6 = false;
+};
+
+bool ParseEndpoint(std::string_view text, Endpoint& value);
+
+template <>
+struct ValueTraits<Endpoint> {
+    static constexpr std::string_view kName = "ip:port";
+    static bool Parse(std::string_view text, Endpoint& value) {
+        return ParseEndpoint(text, value);
+    }
+};
+
+// Names of an enum's values for its built-in traits, e.g.
+//     template <> struct EnumNames<Mode> {
+//         static constexpr std::pair<std::string_view, Mode> kValues[] = {{"fast", Mode::FAST}};
+//     };
+template <typename E>
+struct EnumNames;
+
+template <typename E>
+    requires std::is_enum_v<E>
+struct ValueTraits<E> {
+    static constexpr std::string_view kName = "enum";
+    static bool Parse(std::string_view text, E& value) {
+        for (const auto& [name, enum_value] : EnumNames<E>::kValues) {
+            if (name == text) {
+                value = enum_value;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+}
@@ -1,12 +1,31 @@
 
 #include <sstream>
 #include <fstream>
+#include <filesystem>
+#include <memory_resource>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include <gtest/gtest.h>
 #include <lib/ArgParser.h>
+#include <lib/CommandServer.h>
+#include <lib/Snapshot.h>
+#include <lib/StaticArgParser.h>
+#include <lib/StreamParser.h>
+#include <lib/ThreadPool.h>
+#include <bin/Reduce.h>
 
 using namespace ArgumentParser;
 
+enum class Mode { FAST, SAFE };
+
+template <>
+struct ArgumentParser::EnumNames<Mode> {
+    static constexpr std::pair<std::string_view, Mode> kValues[] = {{"fast", Mode::FAST}, {"safe", Mode::SAFE}};
+};
+
 
 std::vector<std::string> SplitString(const std::string& str) {
     std::istringstream iss(str);
@@ -179,4 +198,1214 @@ TEST(ArgParserTestSuite, HelpStringTest) {
 
     ASSERT_TRUE(parser.Parse(SplitString("app --help")));
 
+}
+
+TEST(ArgParserTestSuite, StringViewParseTest) {
+    ArgParser parser("My Parser");
+    std::string stored;
+    std::vector<std::string> paths;
+    parser.AddStringArgument('o', "output").StoreValue(stored);
+    parser.AddStringArgument("Paths").MultiValue(1).Positional().StoreValues(paths);
+
+    std::string buffer = "app --output=out.txt a.txt b.txt";
+    std::vector<std::string_view> args = {
+        std::string_view(buffer).substr(0, 3),
+        std::string_view(buffer).substr(4, 16),
+        std::string_view(buffer).substr(21, 5),
+        std::string_view(buffer).substr(27, 5),
+    };
+
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_EQ(stored, "out.txt");
+    ASSERT_EQ(parser.GetStringValue("output"), "out.txt");
+    ASSERT_EQ(paths.size(), 2);
+    ASSERT_EQ(paths[1], "b.txt");
+}
+
+TEST(ArgParserTestSuite, FrozenLookupTest) {
+    ArgParser parser("My Parser");
+    for (int i = 0; i < 500; ++i) {
+        parser.AddIntArgument("option" + std::to_string(i));
+    }
+    parser.AddFlag('v', "verbose");
+    parser.AddStringArgument('o', "output");
+    parser.Freeze();
+    ASSERT_TRUE(parser.Frozen());
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --option0=1 --option499=7 --option250 3 -vo=file")));
+    ASSERT_EQ(parser.GetIntValue("option0"), 1);
+    ASSERT_EQ(parser.GetIntValue("option250"), 3);
+    ASSERT_EQ(parser.GetIntValue("option499"), 7);
+    ASSERT_TRUE(parser.GetFlag("verbose"));
+    ASSERT_EQ(parser.GetStringValue("output"), "file");
+    ASSERT_FALSE(parser.Parse(SplitString("app --option500=1")));
+    ASSERT_FALSE(parser.Parse(SplitString("app -x")));
+
+    parser.AddIntArgument("late");
+    ASSERT_FALSE(parser.Frozen());
+    ASSERT_TRUE(parser.Parse(SplitString("app --late=5")));
+    ASSERT_EQ(parser.GetIntValue("late"), 5);
+}
+
+TEST(ArgParserTestSuite, StaticSchemaTest) {
+    using Parser = StaticArgParser<"My Parser", "Some Description about program",
+        StaticFlag<"help", 'h', "Display this help and exit">,
+        StaticFlag<"verbose", 'v', "Verbose output">,
+        StaticIntOption<"number", 'n', "Some Number", 10>,
+        StaticStringOption<"output", 'o', "File path for output", "out.txt">>;
+    Parser parser;
+
+    std::vector<std::string_view> args = {"app", "-vn", "42"};
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_TRUE(parser.Get<"verbose">());
+    ASSERT_EQ(parser.Get<"number">(), 42);
+    ASSERT_EQ(parser.Get<"output">(), "out.txt");
+
+    args = {"app", "--output=a.txt", "--number", "7"};
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_FALSE(parser.Get<"verbose">());
+    ASSERT_EQ(parser.Get<"number">(), 7);
+    ASSERT_EQ(parser.Get<"output">(), "a.txt");
+
+    args = {"app", "--number=x"};
+    ASSERT_FALSE(parser.Parse(args));
+    args = {"app", "--unknown"};
+    ASSERT_FALSE(parser.Parse(args));
+
+    args = {"app", "-h"};
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_TRUE(parser.Help());
+
+    static_assert(Parser::HelpDescription().starts_with("My Parser\nSome Description about program\n\n"));
+    ASSERT_NE(Parser::HelpDescription().find("  -n, --number=<int>, Some Number [default = 10]\n"), std::string_view::npos);
+    ASSERT_NE(Parser::HelpDescription().find("  -v, --verbose, Verbose output\n"), std::string_view::npos);
+
+    args = {"app", "--number=+5"};
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_EQ(parser.Get<"number">(), 5);
+
+    using Defaults = StaticArgParser<"My Parser", "",
+        StaticIntOption<"zero", 'z', "Shown", 0, true>,
+        StaticIntOption<"none", '\0', "Hidden">,
+        StaticStringOption<"path", 'p', "Empty">>;
+    ASSERT_EQ(Defaults::HelpDescription(),
+              "My Parser\n\n  -z, --zero=<int>, Shown [default = 0]\n      --none=<int>, Hidden\n  -p, --path=<string>, Empty\n");
+}
+
+TEST(ArgParserTestSuite, WideNumericTest) {
+    ArgParser parser("My Parser");
+    int64_t offset = 0;
+    std::vector<uint64_t> sizes;
+    parser.AddInt64Argument('o', "offset").StoreValue(offset);
+    parser.AddUInt64Argument("size").MultiValue().StoreValues(sizes);
+    parser.AddDoubleArgument('r', "ratio").Default(0.5);
+    parser.AddInt64Argument("limit").Default(7);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -o=-9000000000 --size=18446744073709551615 --size +1")));
+    ASSERT_EQ(offset, -9000000000LL);
+    ASSERT_EQ(parser.GetInt64Value("offset"), -9000000000LL);
+    ASSERT_EQ(sizes.size(), 2);
+    ASSERT_EQ(sizes[0], 18446744073709551615ULL);
+    ASSERT_EQ(parser.GetUInt64Value("size", 1), 1);
+    ASSERT_DOUBLE_EQ(parser.GetDoubleValue("ratio"), 0.5);
+    ASSERT_EQ(parser.GetInt64Value("limit"), 7);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -r 2.5e3")));
+    ASSERT_DOUBLE_EQ(parser.GetDoubleValue("ratio"), 2500.0);
+}
+
+TEST(ArgParserTestSuite, InvalidNumericTest) {
+    ArgParser parser("My Parser");
+    parser.AddIntArgument("number");
+    parser.AddUInt64Argument("count");
+
+    ASSERT_FALSE(parser.Parse(SplitString("app --number=12abc")));
+    ASSERT_FALSE(parser.Parse(SplitString("app --number=2147483648")));
+    ASSERT_FALSE(parser.Parse(SplitString("app --count=-1")));
+    ASSERT_FALSE(parser.Parse(SplitString("app --count=+-1")));
+    ASSERT_TRUE(parser.Parse(SplitString("app --number=-2147483648")));
+    ASSERT_EQ(parser.GetIntValue("number"), -2147483648LL);
+}
+
+TEST(ArgParserTestSuite, SharedSchemaParseResultTest) {
+    ArgParser parser("My Parser");
+    std::vector<int> unused;
+    parser.AddIntArgument('n', "number").Default(1);
+    parser.AddStringArgument("name").Required();
+    parser.AddIntArgument("Values").MultiValue(1).Positional().StoreValues(unused);
+    parser.Freeze();
+
+    std::vector<std::thread> workers;
+    std::vector<int> sums(8, 0);
+    for (int t = 0; t < 8; ++t) {
+        workers.emplace_back([&parser, &sums, t] {
+            for (int k = 0; k < 100; ++k) {
+                ParseResult result = parser.ParseToResult(SplitString("app --name=w -n " + std::to_string(t) + " 1 2 3"));
+                if (result && result.GetStringValue("name") == "w") {
+                    sums[t] += result.GetIntValue("number") + result.GetIntValue("Values", 2);
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (int t = 0; t < 8; ++t) {
+        ASSERT_EQ(sums[t], 100 * (t + 3));
+    }
+    ASSERT_TRUE(unused.empty());
+}
+
+TEST(ArgParserTestSuite, ParseErrorTest) {
+    ArgParser parser("My Parser");
+    parser.AddIntArgument('n', "number");
+    parser.AddStringArgument("name").Required();
+
+    ParseResult result = parser.ParseToResult(SplitString("app --name=x -n abc"));
+    ASSERT_FALSE(result);
+    ASSERT_EQ(result.Error(), ParseError::INVALID_VALUE);
+    ASSERT_EQ(result.ErrorIndex(), 3);
+    ASSERT_EQ(result.ErrorArgument(), "number");
+
+    result = parser.ParseToResult(SplitString("app -n 5"));
+    ASSERT_EQ(result.Error(), ParseError::MISSING_REQUIRED);
+    ASSERT_EQ(result.ErrorIndex(), ParseResult::npos);
+    ASSERT_EQ(result.ErrorArgument(), "name");
+
+    result = parser.ParseToResult(SplitString("app --name=x --other"));
+    ASSERT_EQ(result.Error(), ParseError::UNKNOWN_OPTION);
+    ASSERT_EQ(result.ErrorIndex(), 2);
+
+    result = parser.ParseToResult(SplitString("app --name=x extra"));
+    ASSERT_EQ(result.Error(), ParseError::UNEXPECTED_POSITIONAL);
+}
+
+TEST(ArgParserTestSuite, ParseBatchTest) {
+    ArgParser parser("My Parser");
+    parser.AddIntArgument('n', "number").Required();
+    parser.AddIntArgument("Values").MultiValue(2).Positional();
+    parser.Freeze();
+
+    std::vector<std::vector<std::string>> lines;
+    for (int i = 0; i < 1000; ++i) {
+        lines.push_back(i % 10 == 0 ? SplitString("app 1 2") : SplitString("app -n " + std::to_string(i) + " 1 2 3"));
+    }
+
+    std::vector<ParseResult> results = parser.ParseBatch(lines, 4);
+    ASSERT_EQ(results.size(), lines.size());
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 10 == 0) {
+            ASSERT_EQ(results[i].Error(), ParseError::MISSING_REQUIRED);
+        } else {
+            ASSERT_TRUE(results[i]);
+            ASSERT_EQ(results[i].GetIntValue("number"), i);
+            ASSERT_EQ(results[i].GetIntValue("Values", 2), 3);
+        }
+    }
+}
+
+TEST(ArgParserTestSuite, IncrementalResetTest) {
+    ArgParser parser("My Parser");
+    std::string output;
+    std::vector<int> numbers;
+    bool verbose = false;
+    for (int i = 0; i < 400; ++i) {
+        parser.AddIntArgument("option" + std::to_string(i));
+    }
+    parser.AddStringArgument('o', "output").StoreValue(output);
+    parser.AddIntArgument('n', "number").MultiValue().StoreValues(numbers);
+    parser.AddFlag('v', "verbose").StoreValue(verbose);
+    parser.AddIntArgument("level").Default(3);
+    parser.Freeze();
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -o out -n 1 -n 2 -v --option7=7")));
+    ASSERT_EQ(output, "out");
+    ASSERT_EQ(numbers.size(), 2);
+    ASSERT_TRUE(verbose);
+    ASSERT_EQ(parser.GetIntValue("option7"), 7);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --option8=8")));
+    ASSERT_EQ(output, "");
+    ASSERT_TRUE(numbers.empty());
+    ASSERT_FALSE(verbose);
+    ASSERT_EQ(parser.GetIntValue("option7"), 0);
+    ASSERT_EQ(parser.GetIntValue("option8"), 8);
+    ASSERT_EQ(parser.GetIntValue("level"), 3);
+}
+
+TEST(ArgParserTestSuite, HandleAccessTest) {
+    ArgParser parser("My Parser");
+    ArgHandle<std::string> output = parser.AddStringArgument('o', "output").Default(std::string("a.txt")).Handle<std::string>();
+    ArgHandle<int> numbers = parser.AddIntArgument("Numbers").MultiValue().Positional().Handle<int>();
+    ArgHandle<bool> verbose = parser.AddFlag('v', "verbose").Handle<bool>();
+    ArgHandle<double> wrong = parser.AddIntArgument("ratio").Handle<double>();
+    ASSERT_TRUE(output.Valid());
+    ASSERT_FALSE(wrong.Valid());
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -v 4 5 6")));
+    ASSERT_EQ(parser.Get(output), "a.txt");
+    ASSERT_TRUE(parser.Get(verbose));
+    ASSERT_EQ(parser.Get(numbers), 4);
+    ASSERT_EQ(parser.Get(numbers, 2), 6);
+    ASSERT_EQ(parser.Get(numbers, 3), 0);
+    std::span<const int> all = parser.GetAll(numbers);
+    ASSERT_EQ(all.size(), 3);
+    ASSERT_EQ(all[1], 5);
+    ASSERT_TRUE(parser.Result().GetAll(wrong).empty());
+}
+
+TEST(ArgParserTestSuite, ParseStatsTest) {
+    struct CountingSink : ParseStatsSink {
+        int calls = 0;
+        uint64_t tokens = 0;
+        void OnParse(const ParseStats& stats) override {
+            ++calls;
+            tokens = stats.tokens;
+        }
+    };
+
+    ArgParser parser("My Parser");
+    CountingSink sink;
+    parser.SetStatsSink(&sink);
+    parser.AddStringArgument('o', "output");
+    parser.AddIntArgument("Numbers").MultiValue().Positional();
+    parser.AddIntArgument("level");
+
+    bool parsed = parser.Parse(SplitString("app -o out --level=x 1 2"));
+    ASSERT_FALSE(parsed);
+#ifdef ARGPARSER_ENABLE_STATS
+    const ParseStats* stats = parser.Result().Stats();
+    ASSERT_NE(stats, nullptr);
+    ASSERT_EQ(stats->tokens, 6);
+    ASSERT_EQ(stats->short_lookups, 1);
+    ASSERT_EQ(stats->long_lookups, 1);
+    ASSERT_EQ(stats->conversions, 1);
+    ASSERT_EQ(stats->conversion_failures, 1);
+    ASSERT_EQ(stats->values_per_argument[0], 1);
+    ASSERT_EQ(sink.calls, 1);
+    ASSERT_EQ(sink.tokens, 6);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --output=out 1 2 3")));
+    ASSERT_EQ(stats->long_misses, 0);
+    ASSERT_EQ(stats->conversions, 3);
+    ASSERT_EQ(stats->values_per_argument[1], 3);
+    ASSERT_EQ(sink.calls, 2);
+#else
+    ASSERT_EQ(parser.Result().Stats(), nullptr);
+    ASSERT_EQ(sink.calls, 0);
+#endif
+}
+
+TEST(ArgParserTestSuite, OnValueStreamingTest) {
+    ArgParser parser("My Parser");
+    int64_t sum = 0;
+    size_t names = 0;
+    parser.AddIntArgument("Numbers").MultiValue(2).Positional().OnValue([&sum](int value) { sum += value; });
+    parser.AddStringArgument('n', "name").MultiValue().OnValue([&names](std::string_view value) { names += value.size(); });
+    parser.AddDoubleArgument("ratio").Default(0.5).OnValue([&sum](double value) { sum += static_cast<int64_t>(value * 10); });
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -n ab -n cde 1 2 3")));
+    ASSERT_EQ(sum, 11);
+    ASSERT_EQ(names, 5);
+    ASSERT_TRUE(parser.Result().GetAll(ArgHandle<int>()).empty());
+    ASSERT_EQ(parser.GetIntValue("Numbers", 0), 0);
+
+    sum = 0;
+    ASSERT_FALSE(parser.Parse(SplitString("app 7")));
+    ASSERT_EQ(parser.Result().Error(), ParseError::TOO_FEW_VALUES);
+    ASSERT_EQ(sum, 7);
+}
+
+TEST(ArgParserTestSuite, ResponseFileTest) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::string outer = (dir / "argparser_outer.rsp").string();
+    std::string inner = (dir / "argparser_inner.rsp").string();
+    std::string loop = (dir / "argparser_loop.rsp").string();
+    std::ofstream(outer) << "--name \"two words\" 'it''s' 1\n@" << inner << "\n";
+    std::ofstream(inner) << "2\t3 -- @not_a_file\n";
+    std::ofstream(loop) << "@" << loop;
+
+    ArgParser parser("My Parser");
+    parser.ResponseFiles();
+    parser.AddStringArgument("name").MultiValue();
+    parser.AddStringArgument("Rest").MultiValue().Positional();
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -- x")));
+    ASSERT_EQ(parser.GetStringValue("Rest"), "x");
+
+    ASSERT_TRUE(parser.Parse(SplitString("app @" + outer + " --name=last")));
+    ASSERT_EQ(parser.GetStringValue("name"), "two words");
+    ASSERT_EQ(parser.GetStringValue("Rest"), "its");
+    ASSERT_EQ(parser.GetStringValue("Rest", 3), "3");
+    ASSERT_EQ(parser.GetStringValue("Rest", 4), "@not_a_file");
+    ASSERT_EQ(parser.GetStringValue("Rest", 5), "--name=last");
+
+    ASSERT_FALSE(parser.Parse(SplitString("app @" + loop)));
+    ASSERT_EQ(parser.Result().Error(), ParseError::RESPONSE_FILE);
+    ASSERT_EQ(parser.Result().ErrorIndex(), 1);
+    ASSERT_FALSE(parser.Parse(SplitString("app @" + (dir / "argparser_missing.rsp").string())));
+
+    // Indices count expanded tokens, so the missing file nested in mid is at 4.
+    std::string missing = (dir / "argparser_missing.rsp").string();
+    std::string mid = (dir / "argparser_mid.rsp").string();
+    std::ofstream(mid) << "a b @" << missing;
+    ASSERT_FALSE(parser.Parse(SplitString("app x @" + mid + " y")));
+    ASSERT_EQ(parser.Result().Error(), ParseError::RESPONSE_FILE);
+    ASSERT_EQ(parser.Result().ErrorIndex(), 4);
+    ASSERT_EQ(parser.Result().ErrorArgument(), missing);
+
+    std::filesystem::remove(outer);
+    std::filesystem::remove(inner);
+    std::filesystem::remove(loop);
+    std::filesystem::remove(mid);
+}
+
+TEST(ArgParserTestSuite, ParallelConversionTest) {
+    ArgParser parser("My Parser");
+    std::vector<int64_t> values;
+    parser.ParallelConversion(4, 8);
+    parser.AddFlag('v', "verbose");
+    parser.AddInt64Argument("Numbers").MultiValue(1).Positional().StoreValues(values);
+
+    std::vector<std::string> args = {"app", "1", "2", "-v"};
+    for (int i = 3; i < 100000; ++i) {
+        args.push_back(std::to_string(i));
+    }
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_TRUE(parser.GetFlag("verbose"));
+    ASSERT_EQ(values.size(), 99999);
+    for (size_t i = 0; i < values.size(); ++i) {
+        ASSERT_EQ(values[i], static_cast<int64_t>(i + 1));
+    }
+
+    args[50000] = "x";
+    args[70000] = "y";
+    args.push_back("--");
+    args.push_back("5");
+    ASSERT_FALSE(parser.Parse(args));
+    ASSERT_EQ(parser.Result().Error(), ParseError::INVALID_VALUE);
+    ASSERT_EQ(parser.Result().ErrorIndex(), 50000);
+
+    args[50000] = "1";
+    args[70000] = "1";
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_EQ(values.size(), 100000);
+    ASSERT_EQ(values.back(), 5);
+}
+
+TEST(ArgParserTestSuite, InterleavedValuesTest) {
+    ArgParser parser("My Parser");
+    ArgHandle<int> first = parser.AddIntArgument('a', "first").MultiValue().Handle<int>();
+    ArgHandle<int> second = parser.AddIntArgument('b', "second").MultiValue().Handle<int>();
+    ArgHandle<std::string> names = parser.AddStringArgument('n', "name").MultiValue().Handle<std::string>();
+
+    std::string line = "app";
+    for (int i = 0; i < 50; ++i) {
+        line += " -a " + std::to_string(i) + " -b " + std::to_string(-i) + " -n n" + std::to_string(i);
+    }
+    ASSERT_TRUE(parser.Parse(SplitString(line)));
+    std::span<const int> a = parser.GetAll(first);
+    std::span<const int> b = parser.GetAll(second);
+    ASSERT_EQ(a.size(), 50);
+    ASSERT_EQ(b.size(), 50);
+    for (int i = 0; i < 50; ++i) {
+        ASSERT_EQ(a[i], i);
+        ASSERT_EQ(b[i], -i);
+        ASSERT_EQ(parser.Get(names, i), "n" + std::to_string(i));
+    }
+    ASSERT_EQ(parser.GetIntValue("name"), 0);
+    ASSERT_EQ(parser.GetStringValue("first"), "");
+}
+
+TEST(ArgParserTestSuite, MemoryResourceTest) {
+    // Anything beyond the buffer would go to the null resource and throw.
+    static char buffer[1 << 16];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    ArgParser parser("My Parser", &arena);
+    parser.AddStringArgument('n', "name").MultiValue();
+    parser.AddIntArgument("Numbers").MultiValue().Positional();
+
+    std::vector<std::string> args = SplitString("app -n first --name=second 1 2 3 4 5");
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_EQ(parser.GetStringValue("name", 1), "second");
+    ASSERT_EQ(parser.GetIntValue("Numbers", 4), 5);
+
+    ParseResult result(&arena);
+    ASSERT_TRUE(parser.ParseInto(result, args));
+    ASSERT_TRUE(parser.ParseInto(result, args));
+    ASSERT_EQ(result.GetStringValue("name"), "first");
+}
+
+TEST(ArgParserTestSuite, LazyConversionTest) {
+    ArgParser parser("My Parser");
+    parser.LazyConversion();
+    ArgHandle<int> level = parser.AddIntArgument('l', "level").Handle<int>();
+    parser.AddDoubleArgument("ratio");
+    parser.AddInt64Argument("Numbers").MultiValue().Positional();
+
+    std::vector<std::string> storage = SplitString("app -l 3 --ratio=abc 1 2 x");
+    std::vector<std::string_view> args(storage.begin(), storage.end());
+    ASSERT_TRUE(parser.Parse(std::span<const std::string_view>(args)));
+    ASSERT_EQ(parser.Get(level), 3);
+    ASSERT_EQ(parser.GetIntValue("level"), 3);
+    ASSERT_EQ(parser.GetDoubleValue("ratio"), 0.0);
+    ASSERT_FALSE(parser.ValidateAll());
+    ASSERT_EQ(parser.Result().Error(), ParseError::INVALID_VALUE);
+    ASSERT_EQ(parser.Result().ErrorIndex(), 3);
+    ASSERT_EQ(parser.Result().ErrorArgument(), "ratio");
+
+    storage = SplitString("app 10 20 30");
+    args.assign(storage.begin(), storage.end());
+    ParseResult result = parser.ParseToResult(args);
+    ASSERT_TRUE(result.ValidateAll());
+    ASSERT_EQ(result.GetInt64Value("Numbers", 2), 30);
+
+    ASSERT_FALSE(parser.Parse(SplitString("app -l x")));
+}
+
+TEST(ArgParserTestSuite, LazyConversionSpanTest) {
+    ArgParser parser("My Parser");
+    parser.LazyConversion();
+    ArgHandle<int> base = parser.AddIntArgument("base").Default(7).Handle<int>();
+    ArgHandle<int> first = parser.AddIntArgument("first").MultiValue().Handle<int>();
+    ArgHandle<int> second = parser.AddIntArgument("second").MultiValue().Handle<int>();
+    ArgHandle<double> ratio = parser.AddDoubleArgument("ratio").Handle<double>();
+
+    std::vector<std::string> storage = SplitString("app --first=1 --first=2 --second=3 --ratio=x --second=4");
+    std::vector<std::string_view> args(storage.begin(), storage.end());
+    ParseResult result = parser.ParseToResult(args);
+    ASSERT_TRUE(result);
+
+    std::span<const int> defaults = result.GetAll(base);
+    std::span<const int> firsts = result.GetAll(first);
+    ASSERT_EQ(result.Get(second, 1), 4);
+    ASSERT_EQ(result.GetAll(base).data(), defaults.data());
+    ASSERT_EQ(result.GetAll(first).data(), firsts.data());
+    ASSERT_EQ(defaults[0], 7);
+    ASSERT_EQ(firsts[1], 2);
+
+    ASSERT_EQ(result.Get(ratio), 0.0);
+    ASSERT_TRUE(result.GetAll(ratio).empty());
+    ASSERT_FALSE(result.ValidateAll());
+    ASSERT_EQ(result.ErrorIndex(), 4);
+    ASSERT_EQ(result.ErrorArgument(), "ratio");
+}
+
+TEST(ArgParserTestSuite, SubcommandTest) {
+    ArgParser parser("Tool");
+    bool verbose = false;
+    parser.AddFlag('v', "verbose").StoreValue(verbose);
+    int built = 0;
+    int depth = 0;
+    parser.AddSubcommand("clone", [&built, &depth](ArgParser& sub) {
+        ++built;
+        sub.AddIntArgument('d', "depth").Default(1).StoreValue(depth);
+        sub.AddStringArgument("Url").Positional().Required();
+    }, "copy a repository");
+    parser.AddSubcommand("status", [&built](ArgParser& sub) {
+        ++built;
+        sub.AddFlag('s', "short");
+    });
+
+    ASSERT_NE(parser.HelpDescription().find("clone, copy a repository"), std::string::npos);
+    ASSERT_EQ(built, 0);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -v clone -d 3 http://host/repo")));
+    ASSERT_EQ(built, 1);
+    ASSERT_TRUE(verbose);
+    ASSERT_EQ(depth, 3);
+    ASSERT_EQ(parser.SelectedSubcommand(), "clone");
+    ASSERT_EQ(parser.Subcommand("clone")->GetStringValue("Url"), "http://host/repo");
+
+    ParseResult result = parser.ParseToResult(SplitString("app status -s"));
+    ASSERT_TRUE(result.Ok());
+    ASSERT_EQ(built, 2);
+    ASSERT_EQ(result.Subcommand(), "status");
+    ASSERT_TRUE(result.SubcommandResult()->GetFlag("short"));
+
+    result = parser.ParseToResult(SplitString("app -v clone -d x"));
+    ASSERT_EQ(result.Error(), ParseError::INVALID_VALUE);
+    ASSERT_EQ(result.ErrorIndex(), 4);
+    ASSERT_EQ(result.ErrorArgument(), "depth");
+
+    result = parser.ParseToResult(SplitString("app push"));
+    ASSERT_EQ(result.Error(), ParseError::UNKNOWN_SUBCOMMAND);
+    ASSERT_EQ(result.ErrorIndex(), 1);
+    ASSERT_EQ(built, 2);
+    ASSERT_EQ(parser.Subcommand("push"), nullptr);
+}
+
+TEST(ArgParserTestSuite, TokenClassifierTest) {
+    ASSERT_EQ(ClassifyToken("-").kind, TokenClass::DASH);
+    ASSERT_EQ(ClassifyToken("--").kind, TokenClass::TERMINATOR);
+    ASSERT_EQ(ClassifyToken("-abc").kind, TokenClass::SHORT_CLUSTER);
+    ASSERT_EQ(ClassifyToken("").kind, TokenClass::POSITIONAL);
+
+    TokenClass long_option = ClassifyToken("--a-rather-long-option-name=value=more");
+    ASSERT_EQ(long_option.kind, TokenClass::LONG_OPTION);
+    ASSERT_EQ(long_option.equals, 27u);
+    ASSERT_EQ(ClassifyToken("--name=1").equals, 6u);
+    ASSERT_EQ(ClassifyToken("--name").equals, TokenClass::kNoEquals);
+
+    ASSERT_EQ(ClassifyToken("--0123456789abcd=").equals, 16u);
+    ASSERT_EQ(ClassifyToken("--0123456789abcdef").equals, TokenClass::kNoEquals);
+    ASSERT_EQ(ClassifyToken("key=value").equals, TokenClass::kNoEquals);
+    ASSERT_EQ(ClassifyToken("-n=5").equals, TokenClass::kNoEquals);
+
+    ArgParser parser("My Parser");
+    parser.AddStringArgument("a-rather-long-option-name");
+    parser.AddIntArgument("Param").MultiValue().Positional();
+    ASSERT_TRUE(parser.Parse(SplitString("app --a-rather-long-option-name=value=more 1 2 -- 3")));
+    ASSERT_EQ(parser.GetStringValue("a-rather-long-option-name"), "value=more");
+    ASSERT_EQ(parser.GetIntValue("Param", 2), 3);
+    ASSERT_FALSE(parser.Parse(SplitString("app - 1")));
+}
+
+TEST(ArgParserTestSuite, ValueTypesTest) {
+    using namespace std::chrono_literals;
+    ArgParser parser("My Parser");
+    ArgHandle<std::chrono::nanoseconds> timeout = parser.AddArgument<std::chrono::nanoseconds>('t', "timeout")
+        .Default("1h30m").Handle<std::chrono::nanoseconds>();
+    ArgHandle<ByteSize> sizes = parser.AddArgument<ByteSize>("size").MultiValue().Handle<ByteSize>();
+    parser.AddArgument<Endpoint>("listen").Required();
+    parser.AddArgument<Mode>("mode").Default("safe");
+    ASSERT_FALSE(parser.Handle<ByteSize>().Valid());
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --size=64MiB --listen [::1]:8080 --size 1.5k --size 7")));
+    ASSERT_EQ(parser.Get(timeout), 90min);
+    ASSERT_EQ(parser.GetAll(sizes).size(), 3);
+    ASSERT_EQ(parser.Get(sizes, 0).bytes, 64ull << 20);
+    ASSERT_EQ(parser.Get(sizes, 1).bytes, 1500u);
+    ASSERT_EQ(parser.Get(sizes, 2).bytes, 7u);
+    Endpoint listen = parser.GetValue<Endpoint>("listen");
+    ASSERT_TRUE(listen.ipv6);
+    ASSERT_EQ(listen.port, 8080);
+    ASSERT_EQ(listen.address[15], 1);
+    ASSERT_EQ(parser.GetValue<Mode>("mode"), Mode::SAFE);
+    ASSERT_EQ(parser.GetValue<ByteSize>("listen").bytes, 0u);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -t 250ms --listen 10.0.0.1:80 --mode=fast")));
+    ASSERT_EQ(parser.Get(timeout), 250ms);
+    ASSERT_EQ(parser.GetValue<Endpoint>("listen").address[0], 10);
+    ASSERT_EQ(parser.GetValue<Mode>("mode"), Mode::FAST);
+    ASSERT_NE(parser.HelpDescription().find("--timeout=<duration>,  [default = 1h30m]"), std::string::npos);
+
+    ASSERT_FALSE(parser.Parse(SplitString("app --listen 10.0.0.1:70000")));
+    ASSERT_FALSE(parser.Parse(SplitString("app --listen 10.0.0.1:80 -t 5parsecs")));
+    ASSERT_EQ(parser.Result().ErrorArgument(), "timeout");
+    ASSERT_FALSE(parser.Parse(SplitString("app --listen 10.0.0.1:80 --mode slow")));
+    ASSERT_FALSE(parser.Parse(SplitString("app --listen 10.0.0.1:80 --size 32EiB")));
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --listen 10.0.0.1:80 --size 1.5KiB --size 0.5MiB --size 0.001KiB")));
+    ASSERT_EQ(parser.Get(sizes, 0).bytes, 1536u);
+    ASSERT_EQ(parser.Get(sizes, 1).bytes, 524288u);
+    ASSERT_EQ(parser.Get(sizes, 2).bytes, 1u);
+    ASSERT_TRUE(parser.Parse(SplitString("app --listen 10.0.0.1:80 --size 18446744073709551615 --size 18014398509481983.999KiB")));
+    ASSERT_EQ(parser.Get(sizes, 1).bytes, UINT64_MAX - 1);
+    ASSERT_EQ(parser.Get(sizes, 0).bytes, UINT64_MAX);
+    ASSERT_FALSE(parser.Parse(SplitString("app --listen 10.0.0.1:80 --size 18446744073709551616")));
+    ASSERT_FALSE(parser.Parse(SplitString("app --listen 10.0.0.1:80 --size 16384PiB")));
+    ASSERT_FALSE(parser.Parse(SplitString("app --listen 10.0.0.1:80 --size 18446744073709551.999k")));
+    ASSERT_TRUE(parser.Parse(SplitString("app --listen 10.0.0.1:80 -t 106751d23h47m16.854775807s")));
+    ASSERT_EQ(parser.Get(timeout).count(), INT64_MAX);
+    ASSERT_FALSE(parser.Parse(SplitString("app --listen 10.0.0.1:80 -t 106751d23h47m16.854775808s")));
+
+    parser.AddArgument<std::chrono::nanoseconds>("retry").Default("soon");
+    ASSERT_FALSE(parser.Parse(SplitString("app --listen 10.0.0.1:80 --retry 1s")));
+    ASSERT_EQ(parser.Result().Error(), ParseError::INVALID_VALUE);
+    ASSERT_EQ(parser.Result().ErrorArgument(), "retry");
+}
+
+TEST(ArgParserTestSuite, StreamParserTest) {
+    ArgParser parser("My Parser");
+    parser.AddStringArgument('n', "name").Required();
+    parser.AddFlag('v', "verbose");
+    parser.AddIntArgument("level").Default(2);
+    parser.AddIntArgument("Param").MultiValue(1).Positional();
+
+    StreamParser stream(parser);
+    std::vector<std::string> events;
+    stream.OnEvent([&events](const ParseEvent& event) {
+        events.push_back(std::string(event.argument) + ":" + std::string(event.value));
+    });
+
+    std::string name = "first";
+    ASSERT_TRUE(stream.Feed("app"));
+    ASSERT_TRUE(stream.Feed("-vn"));
+    ASSERT_TRUE(stream.Feed(name));
+    name = "overwritten";
+    ASSERT_EQ(stream.Result().GetStringValue("name"), "first");
+    ASSERT_TRUE(stream.Result().GetFlag("verbose"));
+    ASSERT_TRUE(stream.Feed("1"));
+    ASSERT_TRUE(stream.Feed("--"));
+    ASSERT_TRUE(stream.Feed("-2"));
+    ASSERT_TRUE(stream.Finish());
+    ASSERT_EQ(stream.Result().GetIntValue("level"), 2);
+    ASSERT_EQ(stream.Result().GetIntValue("Param", 1), -2);
+    ASSERT_EQ(events, (std::vector<std::string>{"verbose:", "name:first", "Param:1", "Param:-2"}));
+
+    ASSERT_TRUE(stream.Feed("app"));
+    ASSERT_TRUE(stream.Feed("5"));
+    ASSERT_TRUE(stream.Feed("--level"));
+    ASSERT_FALSE(stream.Finish());
+    ASSERT_EQ(stream.Result().Error(), ParseError::MISSING_VALUE);
+    ASSERT_EQ(stream.Result().ErrorIndex(), 2);
+
+    for (const std::string& token : SplitString("app --level=x -n a 1")) {
+        stream.Feed(token);
+    }
+    ASSERT_FALSE(stream.Finish());
+    ASSERT_EQ(stream.Result().Error(), ParseError::INVALID_VALUE);
+    ASSERT_EQ(stream.Result().ErrorIndex(), 1);
+    ASSERT_EQ(events.back(), "level:");
+
+    for (const std::string& token : SplitString("app 1 2")) {
+        stream.Feed(token);
+    }
+    ASSERT_FALSE(stream.Finish());
+    ASSERT_EQ(stream.Result().Error(), ParseError::MISSING_REQUIRED);
+}
+
+TEST(ArgParserTestSuite, CommandServerTest) {
+    ArgParser parser("My Parser");
+    parser.AddStringArgument('n', "name").Required();
+    parser.AddFlag('v', "verbose");
+    parser.AddDoubleArgument("ratio").Default(0.5);
+    parser.AddIntArgument("Param").MultiValue().Positional();
+    parser.AddHelp('h', "help", "Some Description about program");
+    parser.Freeze();
+
+    std::string path = (std::filesystem::temp_directory_path() / ("argparser_" + std::to_string(::getpid()) + ".sock")).string();
+    CommandServer server(parser, 2);
+    ASSERT_TRUE(server.Start(path));
+
+    std::vector<std::thread> clients;
+    std::atomic<int> matched = 0;
+    for (int t = 0; t < 4; ++t) {
+        clients.emplace_back([&path, &matched, t] {
+            std::vector<std::string> storage = SplitString("app -v --name=w" + std::to_string(t) + " 1 2 3");
+            std::vector<std::string_view> args(storage.begin(), storage.end());
+            CommandReply reply;
+            using Values = std::vector<std::pair<std::string, std::vector<std::string>>>;
+            Values expected = {{"verbose", {"true"}}, {"name", {"w" + std::to_string(t)}},
+                               {"Param", {"1", "2", "3"}}, {"ratio", {"0.5"}}};
+            if (SendCommand(path, args, reply) && reply.error == ParseError::NONE && reply.values == expected) {
+                ++matched;
+            }
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    ASSERT_EQ(matched, 4);
+
+    std::vector<std::string_view> bad = {"app", "-n", "x", "y"};
+    CommandReply reply;
+    ASSERT_TRUE(SendCommand(path, bad, reply));
+    ASSERT_EQ(reply.error, ParseError::INVALID_VALUE);
+    ASSERT_EQ(reply.error_index, 3);
+    ASSERT_EQ(reply.error_argument, "Param");
+
+    std::vector<std::string_view> typo = {"app", "-n", "x", "--verbsoe"};
+    ASSERT_TRUE(SendCommand(path, typo, reply));
+    ASSERT_EQ(reply.error, ParseError::UNKNOWN_OPTION);
+    ASSERT_EQ(reply.error_argument, "verbsoe");
+    ASSERT_EQ(reply.suggestion, "verbose");
+
+    std::vector<std::string_view> help = {"app", "--help"};
+    ASSERT_TRUE(SendCommand(path, help, reply));
+    ASSERT_TRUE(reply.help);
+    ASSERT_EQ(reply.help_text, parser.HelpDescription());
+
+    ASSERT_EQ(std::filesystem::status(path).permissions() & std::filesystem::perms::all,
+              std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+
+    // Both workers are held by clients that never send; they are dropped at the deadline.
+    std::vector<int> idle;
+    for (int i = 0; i < 2; ++i) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.data(), path.size());
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        ASSERT_EQ(::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+        idle.push_back(fd);
+    }
+    ASSERT_TRUE(SendCommand(path, help, reply));
+    ASSERT_TRUE(reply.help);
+    for (int fd : idle) {
+        ::close(fd);
+    }
+
+    server.Stop();
+    ASSERT_FALSE(std::filesystem::exists(path));
+    ASSERT_FALSE(SendCommand(path, help, reply));
+
+    std::string secret = (std::filesystem::temp_directory_path() / "argparser_secret.rsp").string();
+    std::ofstream(secret) << "--name leaked";
+    ArgParser files("My Parser");
+    files.ResponseFiles();
+    files.AddStringArgument('n', "name");
+    files.AddStringArgument("Rest").MultiValue().Positional();
+    files.AddSubcommand("push", [](ArgParser& sub) {
+        sub.ResponseFiles();
+        sub.AddIntArgument("depth");
+        sub.AddStringArgument("Ref").Positional();
+    });
+    files.Freeze();
+    CommandServer file_server(files, 1);
+    ASSERT_TRUE(file_server.Start(path));
+
+    std::string token = "@" + secret;
+    std::vector<std::string_view> expand = {"app", token};
+    ASSERT_TRUE(SendCommand(path, expand, reply));
+    ASSERT_EQ(reply.error, ParseError::NONE);
+    using Values = std::vector<std::pair<std::string, std::vector<std::string>>>;
+    ASSERT_EQ(reply.values, (Values{{"Rest", {token}}}));
+
+    std::vector<std::string_view> push = {"app", "-n", "x", "push", "--depth=3", "main"};
+    ASSERT_TRUE(SendCommand(path, push, reply));
+    ASSERT_EQ(reply.values, (Values{{"name", {"x"}}}));
+    ASSERT_EQ(reply.subcommand, "push");
+    ASSERT_NE(reply.subcommand_reply, nullptr);
+    ASSERT_EQ(reply.subcommand_reply->values, (Values{{"depth", {"3"}}, {"Ref", {"main"}}}));
+    ASSERT_EQ(reply.subcommand_reply->subcommand_reply, nullptr);
+
+    std::vector<std::string_view> nested = {"app", "push", token};
+    ASSERT_TRUE(SendCommand(path, nested, reply));
+    ASSERT_EQ(reply.subcommand_reply->values, (Values{{"Ref", {token}}}));
+
+    file_server.Stop();
+    std::filesystem::remove(secret);
+}
+
+TEST(ArgParserTestSuite, SnapshotTest) {
+    std::string path = (std::filesystem::temp_directory_path() / ("argparser_" + std::to_string(::getpid()) + ".snap")).string();
+    {
+        ArgParser parser("My Parser");
+        parser.LazyConversion();
+        parser.AddStringArgument('n', "name");
+        parser.AddFlag('v', "verbose");
+        parser.AddFlag("quiet");
+        parser.AddDoubleArgument("ratio").Default(0.5);
+        parser.AddArgument<ByteSize>("limit").Default("1KiB");
+        parser.AddInt64Argument("Param").MultiValue().Positional();
+        parser.AddStringArgument("mode").Default("old");
+        parser.AddIntArgument("mode").Default(7);
+        std::vector<std::string> storage = SplitString("app -v --name=first -n second 1 -- -2 3");
+        std::vector<std::string_view> args(storage.begin(), storage.end());
+        ASSERT_TRUE(parser.Parse(std::span<const std::string_view>(args)));
+        ASSERT_EQ(parser.GetIntValue("mode"), 7);
+        ASSERT_FALSE(Snapshot::Write(parser.ParseToResult(SplitString("app --missing")), path));
+
+        // Writers racing on one path each replace the file whole.
+        std::vector<std::thread> writers;
+        std::atomic<int> written = 0;
+        for (int t = 0; t < 4; ++t) {
+            writers.emplace_back([&parser, &path, &written] {
+                for (int i = 0; i < 20; ++i) {
+                    written += Snapshot::Write(parser.Result(), path) ? 1 : 0;
+                }
+            });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+        ASSERT_EQ(written, 80);
+    }
+
+    Snapshot snapshot;
+    ASSERT_TRUE(snapshot.Open(path));
+    ASSERT_EQ(snapshot.GetStringValue("name", 1), "second");
+    ASSERT_EQ(snapshot.ValueCount("name"), 2);
+    ASSERT_TRUE(snapshot.GetFlag("verbose"));
+    ASSERT_FALSE(snapshot.GetFlag("quiet"));
+    ASSERT_TRUE(snapshot.Contains("quiet"));
+    ASSERT_FALSE(snapshot.Contains("missing"));
+    ASSERT_EQ(snapshot.GetDoubleValue("ratio"), 0.5);
+    ASSERT_EQ(snapshot.GetValue<ByteSize>("limit").bytes, 1024u);
+    ASSERT_EQ(snapshot.GetAll<int64_t>("Param").size(), 3);
+    ASSERT_EQ(snapshot.GetInt64Value("Param", 1), -2);
+    ASSERT_EQ(snapshot.GetIntValue("Param"), 0);
+    ASSERT_FALSE(snapshot.Help());
+    ASSERT_EQ(snapshot.GetIntValue("mode"), 7);
+    snapshot.Close();
+
+    // The slot table follows the 40-byte header and one 32-byte entry per argument.
+    auto rewrite_slots = [&path](uint32_t used, uint32_t value) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        uint32_t counts[2];
+        file.seekg(24);
+        file.read(reinterpret_cast<char*>(counts), sizeof(counts));
+        file.seekp(40 + counts[0] * 32);
+        for (uint32_t slot = 0; slot < counts[1]; ++slot) {
+            uint32_t index = slot < used ? value : 0;
+            file.write(reinterpret_cast<const char*>(&index), sizeof(index));
+        }
+    };
+    Snapshot corrupt;
+    rewrite_slots(UINT32_MAX, 1);
+    ASSERT_FALSE(corrupt.Open(path));
+    rewrite_slots(2, 1);
+    ASSERT_FALSE(corrupt.Open(path));
+    rewrite_slots(1, 1);
+    ASSERT_TRUE(corrupt.Open(path));
+    ASSERT_FALSE(corrupt.Contains("missing"));
+    corrupt.Close();
+
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(8);
+        file.put(static_cast<char>(Snapshot::kVersion + 1));
+    }
+    Snapshot stale;
+    ASSERT_FALSE(stale.Open(path));
+    std::filesystem::remove(path);
+}
+
+TEST(ArgParserTestSuite, AddArgumentsTest) {
+    static constexpr ArgSpec kOptions[] = {
+        {.type = ArgSpec::STRING, .short_name = 'o', .name = "output", .help = "where to write", .required = true},
+        {.type = ArgSpec::INT, .short_name = 'l', .name = "level", .default_value = "3", .has_default = true},
+        {.type = ArgSpec::FLAG, .name = "color", .default_value = "true", .has_default = true},
+        {.type = ArgSpec::DOUBLE, .name = "ratio", .default_value = "half", .has_default = true},
+        {.type = ArgSpec::UINT64, .name = "Sizes", .multi_value = true, .min_count = 2, .positional = true},
+    };
+
+    ArgParser parser("My Parser");
+    parser.AddFlag('v', "verbose");
+    ASSERT_FALSE(parser.AddArguments(kOptions));
+    parser.AddInt64Argument("after").Default(7);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -o out 10 20 -v")));
+    ASSERT_EQ(parser.GetStringValue("output"), "out");
+    ASSERT_EQ(parser.GetIntValue("level"), 3);
+    ASSERT_TRUE(parser.GetFlag("color"));
+    ASSERT_TRUE(parser.GetFlag("verbose"));
+    ASSERT_EQ(parser.GetDoubleValue("ratio"), 0.0);
+    ASSERT_EQ(parser.GetUInt64Value("Sizes", 1), 20u);
+    ASSERT_EQ(parser.GetInt64Value("after"), 7);
+    ASSERT_NE(parser.HelpDescription().find("-o, --output=<string>, where to write"), std::string::npos);
+
+    ASSERT_FALSE(parser.Parse(SplitString("app 10 20")));
+    ASSERT_EQ(parser.Result().Error(), ParseError::MISSING_REQUIRED);
+    ASSERT_FALSE(parser.Parse(SplitString("app -o out 10")));
+    ASSERT_EQ(parser.Result().Error(), ParseError::TOO_FEW_VALUES);
+
+    parser.Freeze();
+    ASSERT_TRUE(parser.Parse(SplitString("app --output=x -l 5 1 2 3")));
+    ASSERT_EQ(parser.GetIntValue("level"), 5);
+}
+
+TEST(ArgParserTestSuite, AbbreviationsTest) {
+    ArgParser parser("My Parser");
+    parser.AddFlag("verbose");
+    parser.AddFlag("version");
+    parser.AddIntArgument("value");
+    parser.AddStringArgument("output");
+    parser.AddFlag("out");
+
+    ParseResult result = parser.ParseToResult(SplitString("app --verb"));
+    ASSERT_EQ(result.Error(), ParseError::UNKNOWN_OPTION);
+    ASSERT_EQ(result.ErrorArgument(), "verb");
+    ASSERT_EQ(result.Suggestion(), "");
+
+    parser.Abbreviations();
+    for (bool frozen : {false, true}) {
+        if (frozen) {
+            parser.Freeze();
+        }
+        result = parser.ParseToResult(SplitString("app --verb --vers --va=4 --outp file --out"));
+        ASSERT_TRUE(result);
+        ASSERT_TRUE(result.GetFlag("verbose"));
+        ASSERT_TRUE(result.GetFlag("version"));
+        ASSERT_EQ(result.GetIntValue("value"), 4);
+        ASSERT_EQ(result.GetStringValue("output"), "file");
+        ASSERT_TRUE(result.GetFlag("out"));
+
+        result = parser.ParseToResult(SplitString("app --ver"));
+        ASSERT_EQ(result.Error(), ParseError::AMBIGUOUS_OPTION);
+        ASSERT_EQ(result.ErrorIndex(), 1);
+
+        result = parser.ParseToResult(SplitString("app --verbsoe"));
+        ASSERT_EQ(result.Error(), ParseError::UNKNOWN_OPTION);
+        ASSERT_EQ(result.ErrorArgument(), "verbsoe");
+        ASSERT_EQ(result.Suggestion(), "verbose");
+
+        result = parser.ParseToResult(SplitString("app --colour=red"));
+        ASSERT_EQ(result.Error(), ParseError::UNKNOWN_OPTION);
+        ASSERT_EQ(result.ErrorArgument(), "colour");
+        ASSERT_EQ(result.Suggestion(), "");
+
+        result = parser.ParseToResult(SplitString("app --verb --vers"));
+        ASSERT_TRUE(result);
+        ASSERT_EQ(result.Suggestion(), "");
+    }
+
+    StreamParser stream(parser);
+    ASSERT_TRUE(stream.Feed("app"));
+    ASSERT_TRUE(stream.Feed("--outp"));
+    ASSERT_TRUE(stream.Feed("file"));
+    ASSERT_TRUE(stream.Finish());
+    ASSERT_EQ(stream.Result().GetStringValue("output"), "file");
+}
+
+TEST(ArgParserTestSuite, ReduceAccumulatorTest) {
+    using Reduce::Accumulator;
+    using Reduce::Operation;
+    constexpr int64_t kMax = INT64_MAX;
+    constexpr int64_t kMin = INT64_MIN;
+
+    // Crossing the int64 range and coming back is exact.
+    Accumulator sum = Accumulator::Identity(Operation::SUM);
+    sum.Add(kMax);
+    sum.Add(1);
+    ASSERT_EQ(sum.wraps, 1);
+    ASSERT_FALSE(sum.Fits(64));
+    ASSERT_EQ(sum.Wrapped(64), kMin);
+    sum.Add(-1);
+    ASSERT_EQ(sum.wraps, 0);
+    ASSERT_TRUE(sum.Fits(64));
+    ASSERT_EQ(sum.Wrapped(64), kMax);
+    sum.Add(kMin);
+    sum.Add(kMin);
+    sum.Add(2);
+    ASSERT_EQ(sum.wraps, 0);
+    ASSERT_TRUE(sum.Fits(64));
+    ASSERT_EQ(sum.Wrapped(64), -kMax);
+
+    Accumulator narrow = Accumulator::Identity(Operation::SUM);
+    narrow.Add(INT32_MAX);
+    ASSERT_TRUE(narrow.Fits(32));
+    ASSERT_EQ(narrow.Wrapped(32), INT32_MAX);
+    narrow.Add(1);
+    ASSERT_FALSE(narrow.Fits(32));
+    ASSERT_TRUE(narrow.Fits(64));
+    ASSERT_EQ(narrow.Wrapped(32), INT32_MIN);
+    narrow.Add(-2 * int64_t(INT32_MAX) - 2);
+    ASSERT_TRUE(narrow.Fits(32));
+    ASSERT_EQ(narrow.Wrapped(32), INT32_MIN);
+    narrow.Add(-1);
+    ASSERT_FALSE(narrow.Fits(32));
+    ASSERT_EQ(narrow.Wrapped(32), INT32_MAX);
+
+    Accumulator low = Accumulator::Identity(Operation::SUM);
+    low.Add(kMin);
+    low.Add(-1);
+    Accumulator high = Accumulator::Identity(Operation::SUM);
+    high.Add(kMax);
+    high.Add(2);
+    ASSERT_EQ(low.wraps, -1);
+    ASSERT_EQ(high.wraps, 1);
+    low.Merge(high);
+    ASSERT_EQ(low.wraps, 0);
+    ASSERT_TRUE(low.Fits(64));
+    ASSERT_EQ(low.Wrapped(64), 0);
+
+    // An overflowed product stays overflowed unless it is exactly 2^63 and meets -1, or
+    // a zero factor shows up.
+    Accumulator product = Accumulator::Identity(Operation::PRODUCT);
+    product.Add(int64_t(1) << 31);
+    product.Add(int64_t(1) << 31);
+    ASSERT_TRUE(product.Fits(64));
+    ASSERT_FALSE(product.Fits(32));
+    product.Add(2);
+    ASSERT_FALSE(product.Fits(64));
+    ASSERT_EQ(product.Wrapped(64), kMin);
+    product.Add(-1);
+    ASSERT_TRUE(product.Fits(64));
+    ASSERT_EQ(product.Wrapped(64), kMin);
+    product.Add(-1);
+    product.Add(-1);
+    ASSERT_TRUE(product.Fits(64));
+    product.Add(-1);
+    product.Add(3);
+    product.Add(-1);
+    ASSERT_FALSE(product.Fits(64));
+    Accumulator top = Accumulator::Identity(Operation::PRODUCT);
+    top.Add(int64_t(1) << 62);
+    top.Add(2);
+    Accumulator minus_one = Accumulator::Identity(Operation::PRODUCT);
+    minus_one.Add(-1);
+    minus_one.Add(-1);
+    minus_one.Add(-1);
+    minus_one.Merge(top);
+    ASSERT_TRUE(minus_one.Fits(64));
+    ASSERT_EQ(minus_one.Wrapped(64), kMin);
+    product.Add(0);
+    ASSERT_TRUE(product.Fits(32));
+    ASSERT_EQ(product.Wrapped(32), 0);
+
+    std::vector<int64_t> values;
+    for (int64_t i = 1; i <= 45; ++i) {
+        values.push_back(i % 7 == 0 ? kMax - i : -i * 1000003);
+    }
+    for (Operation operation : {Operation::SUM, Operation::PRODUCT, Operation::WRAPPING_PRODUCT}) {
+        Accumulator serial = Accumulator::Identity(operation);
+        for (int64_t value : values) {
+            serial.Add(value);
+        }
+        Accumulator lanes = Reduce::ReduceSpan(values, operation);
+        ASSERT_EQ(lanes.value, serial.value);
+        ASSERT_EQ(lanes.Fits(64), serial.Fits(64));
+        ASSERT_EQ(lanes.wraps, serial.wraps);
+        ASSERT_EQ(lanes.overflow, serial.overflow);
+    }
+    ASSERT_EQ(Reduce::ReduceSpan(values, Operation::WRAPPING_PRODUCT).value,
+              Reduce::ReduceSpan(values, Operation::PRODUCT).value);
+
+    Reduce::StreamReducer stream;
+    for (int64_t value : values) {
+        stream.Push(value);
+    }
+    stream.Select(Operation::SUM);
+    for (int64_t value : values) {
+        stream.Push(value);
+    }
+    stream.Flush();
+    Accumulator twice = Reduce::ReduceSpan(values, Operation::SUM);
+    twice.Merge(twice);
+    ASSERT_EQ(stream.Result(Operation::SUM).value, twice.value);
+    ASSERT_EQ(stream.Result(Operation::SUM).wraps, twice.wraps);
+}
+
+TEST(ArgParserTestSuite, StaticPositionalTest) {
+    using Parser = StaticArgParser<"Program", "Program accumulate arguments",
+        StaticPositional<"N", "values", int64_t, 1>,
+        StaticFlag<"sum", '\0', "add args">,
+        StaticFlag<"help", 'h', "Display this help and exit">,
+        StaticRequired<StaticStringOption<"mode", 'm', "how">>>;
+    Parser parser;
+
+    std::vector<std::string_view> args = {"app", "-m", "x", "1", "2", "3", "--sum"};
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_EQ(parser.Get<"N">().size(), 3);
+    ASSERT_EQ(parser.Get<"N">()[2], 3);
+    ASSERT_TRUE(parser.Get<"sum">());
+
+    char program[] = "app";
+    char mode[] = "--mode=fast";
+    char separator[] = "--";
+    char negative[] = "-7";
+    char* argv[] = {program, mode, separator, negative};
+    ASSERT_TRUE(parser.Parse(4, argv));
+    ASSERT_EQ(parser.Get<"mode">(), "fast");
+    ASSERT_EQ(parser.Get<"N">().size(), 1);
+    ASSERT_EQ(parser.Get<"N">()[0], -7);
+
+    // Same token rules as ArgParser
+    args = {"app", "--mode=", "slow", "1"};
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_EQ(parser.Get<"mode">(), "slow");
+    args = {"app", "--mode", "--", "1"};
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_EQ(parser.Get<"mode">(), "--");
+    args = {"app", "-m", "a", "1", "-m", "b"};
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_EQ(parser.Get<"mode">(), "b");
+    args = {"app", "-h"};
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_TRUE(parser.Help());
+
+    args = {"app", "-m", "x"};
+    ASSERT_FALSE(parser.Parse(args));
+    args = {"app", "1"};
+    ASSERT_FALSE(parser.Parse(args));
+    args = {"app", "-m", "x", "1", "y"};
+    ASSERT_FALSE(parser.Parse(args));
+    args = {"app", "-m", "x", "-1"};
+    ASSERT_FALSE(parser.Parse(args));
+
+    // Where it differs: one run of positional tokens, never named
+    args = {"app", "-m", "x", "1", "--sum", "2"};
+    ASSERT_FALSE(parser.Parse(args));
+    args = {"app", "-m", "x", "1", "--", "2"};
+    ASSERT_FALSE(parser.Parse(args));
+    args = {"app", "-m", "x", "--N=1"};
+    ASSERT_FALSE(parser.Parse(args));
+
+    ASSERT_NE(Parser::HelpDescription().find("      --N=<int64>, values [repeated, min args = 1]\n"), std::string_view::npos);
+}
+
+TEST(ArgParserTestSuite, ParallelConversionSubcommandTest) {
+    auto thread_count = [] {
+        return std::distance(std::filesystem::directory_iterator("/proc/self/task"), std::filesystem::directory_iterator());
+    };
+    ArgParser parser("Tool");
+    parser.ParallelConversion(4, 8);
+    parser.AddInt64Argument("Numbers").MultiValue().Positional();
+    parser.AddSubcommand("show", [](ArgParser& sub) {
+        sub.AddFlag('a', "all");
+    });
+
+    auto before = thread_count();
+    ASSERT_TRUE(parser.Parse(SplitString("app 1 2 3 show -a")));
+    ASSERT_EQ(thread_count(), before);
+
+    std::vector<std::string> args = {"app"};
+    for (int i = 0; i < 20; ++i) {
+        args.push_back(std::to_string(i));
+    }
+    args.push_back("show");
+    args.push_back("-a");
+    ASSERT_TRUE(parser.Parse(args));
+    ASSERT_EQ(parser.Result().Subcommand(), "show");
+    ASSERT_TRUE(parser.Result().SubcommandResult()->GetFlag("all"));
+    ASSERT_EQ(parser.Result().GetInt64Value("Numbers", 19), 19);
+    ASSERT_EQ(thread_count(), before + 3);
+}
+
+TEST(ArgParserTestSuite, ParseBatchPoolTest) {
+    auto thread_count = [] {
+        return std::distance(std::filesystem::directory_iterator("/proc/self/task"), std::filesystem::directory_iterator());
+    };
+    ArgParser parser("My Parser");
+    parser.AddIntArgument('n', "number").Required();
+    parser.Freeze();
+
+    std::vector<std::vector<std::string>> lines;
+    for (int i = 0; i < 10; ++i) {
+        lines.push_back(SplitString("app -n " + std::to_string(i)));
+    }
+    auto before = thread_count();
+    std::vector<ParseResult> results = parser.ParseBatch(lines, 4);
+    ASSERT_EQ(thread_count(), before);
+    ASSERT_EQ(results[9].GetIntValue("number"), 9);
+
+    while (lines.size() < 1000) {
+        lines.push_back(SplitString("app -n " + std::to_string(lines.size())));
+    }
+    results = parser.ParseBatch(lines, 4);
+    ASSERT_EQ(thread_count(), before + 3);
+    results = parser.ParseBatch(lines, 4);
+    ASSERT_EQ(thread_count(), before + 3);
+    ASSERT_EQ(results[999].GetIntValue("number"), 999);
+
+    ThreadPool pool(2);
+    results = parser.ParseBatch(lines, pool);
+    ASSERT_EQ(thread_count(), before + 4);
+    ASSERT_EQ(results[500].GetIntValue("number"), 500);
+}
+
+TEST(ArgParserTestSuite, ResultMoveAcrossResourcesTest) {
+    ArgParser parser("Tool");
+    ArgHandle<std::string> name = parser.AddStringArgument('n', "name").MultiValue().Handle<std::string>();
+    parser.AddSubcommand("show", [](ArgParser& sub) {
+        sub.AddStringArgument("What").Positional();
+    });
+
+    std::pmr::monotonic_buffer_resource arena;
+    ParseResult target(&arena);
+    std::string long_value(100, 'x');
+    std::vector<std::string> args = {"app", "-n", "short", "--name", long_value, "show", "all"};
+    target = parser.ParseToResult(args);
+    ASSERT_TRUE(target);
+    ASSERT_EQ(target.Get(name, 0), "short");
+    ASSERT_EQ(target.Get(name, 1), long_value);
+    ASSERT_EQ(target.Subcommand(), "show");
+    ASSERT_EQ(target.SubcommandResult()->GetStringValue("What"), "all");
+
+    target = parser.ParseToResult(std::vector<std::string>{"app", "--nme", "x"});
+    ASSERT_EQ(target.Error(), ParseError::UNKNOWN_OPTION);
+    ASSERT_EQ(target.ErrorArgument(), "nme");
+    ASSERT_EQ(target.Suggestion(), "name");
 }
\ No newline at end of file